@@ -0,0 +1,649 @@
+/************************************************************************************[CircBench.cc]
+Part of the Mini Circuit Library. See the file LICENSE for copyright and permission notice.
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "minisat/utils/System.h"
+#include "mcl/Circ.h"
+#include "mcl/CircPrelude.h"
+#include "mcl/SatSweep.h"
+#include "mcl/SeqCirc.h"
+#include "mcl/SimKey.h"
+#include "mcl/Simulate.h"
+
+using namespace Minisat;
+
+//=================================================================================================
+// Basic helpers:
+//
+
+// Pick a random signal, biased towards recently created ones to get some depth in the circuit:
+static inline Sig randomSig(double& seed, const vec<Sig>& xs)
+{
+    int window = xs.size() < 1024 ? xs.size() : 1024;
+    int i      = irand(seed, 4) == 0 ? irand(seed, xs.size()) : xs.size() - 1 - irand(seed, window);
+    return xs[i] ^ (bool)irand(seed, 2);
+}
+
+
+// Build a random circuit with 'n_inps' inputs and (approximately) 'n_ands' and-gates:
+static void randomCirc(Circ& c, int n_inps, int n_ands, double& seed)
+{
+    vec<Sig> xs;
+    for (int i = 0; i < n_inps; i++)
+        xs.push(c.mkInp());
+
+    while (c.nGates() < n_ands){
+        Sig x = randomSig(seed, xs);
+        Sig y = randomSig(seed, xs);
+        int n = c.nGates();
+        Sig z = c.mkAnd(x, y);
+        if (c.nGates() > n)
+            xs.push(z);
+    }
+}
+
+
+// Wall-clock time (cpuTime() sums over all threads):
+static double realTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1000000;
+}
+
+
+static void printRate(const char* what, uint64_t n, double time)
+{
+    printf("| %-30s %12"PRIu64" %10.3f s %12.0f /s |\n", what, n, time, time > 0 ? n / time : 0);
+}
+
+//=================================================================================================
+// Structural hashing:
+//
+
+static void benchStrash(int n_ands, int n_lookups)
+{
+    double seed = 123456789;
+    Circ   c;
+
+    double build_time = cpuTime();
+    randomCirc(c, n_ands / 16 + 2, n_ands, seed);
+    build_time = cpuTime() - build_time;
+
+    // Collect queries (outside of the timed loops):
+    vec<Gate> ands;
+    vec<Sig>  inps;
+    for (GateIt git = c.begin(); git != c.end(); ++git)
+        if (type(*git) == gtype_And)
+            ands.push(*git);
+        else
+            inps.push(mkSig(*git));
+
+    vec<Sig> hit_xs, hit_ys, miss_xs, miss_ys;
+    for (int i = 0; i < n_lookups; i++){
+        Gate g = ands[irand(seed, ands.size())];
+        hit_xs.push(c.lchild(g));
+        hit_ys.push(c.rchild(g));
+
+        // Pairs of inputs are (almost) never strashed, and are not affected by rewrite rules:
+        miss_xs.push(inps[irand(seed, inps.size())] ^ (bool)irand(seed, 2));
+        miss_ys.push(inps[irand(seed, inps.size())] ^ (bool)irand(seed, 2));
+    }
+
+    uint32_t check = 0;
+
+    double hit_time = cpuTime();
+    for (int i = 0; i < n_lookups; i++)
+        check += c.tryAnd(hit_xs[i], hit_ys[i]).x;
+    hit_time = cpuTime() - hit_time;
+
+    double miss_time = cpuTime();
+    for (int i = 0; i < n_lookups; i++)
+        check += c.tryAnd(miss_xs[i], miss_ys[i]).x;
+    miss_time = cpuTime() - miss_time;
+
+    // 'mkAnd()' on existing gates only pays for the lookup:
+    double mk_hit_time = cpuTime();
+    for (int i = 0; i < n_lookups; i++)
+        check += c.mkAnd(hit_xs[i], hit_ys[i]).x;
+    mk_hit_time = cpuTime() - mk_hit_time;
+
+    // Inserting the missed pairs includes growing (and migrating) the table:
+    GateSize n_before    = c.nGates();
+    double   insert_time = cpuTime();
+    for (int i = 0; i < n_lookups; i++)
+        check += c.mkAnd(miss_xs[i], miss_ys[i]).x;
+    insert_time = cpuTime() - insert_time;
+
+    printf("|  Gates: %12"PRIgs"    Inputs: %10d    (check %08x)           |\n", n_before, c.nInps(), check);
+    printRate("mkAnd (build)",   n_before,  build_time);
+    printRate("mkAnd (hit)",     n_lookups, mk_hit_time);
+    printRate("mkAnd (insert)",  n_lookups, insert_time);
+    printRate("tryAnd (hit)",    n_lookups, hit_time);
+    printRate("tryAnd (miss)",   n_lookups, miss_time);
+}
+
+//=================================================================================================
+// Gate representation (compare builds with and without 'MCL_WIDE_GATES'):
+//
+
+static void benchGates(int n_ands)
+{
+    double seed = 123456789;
+    double mem  = memUsed();
+    double time = cpuTime();
+    Circ   c;
+    randomCirc(c, n_ands / 16 + 2, n_ands, seed);
+    time = cpuTime() - time;
+    mem  = memUsed() - mem;
+
+    printf("|  Gates: %12"PRIgs"    Inputs: %10d    Word size: %2d bits         |\n", c.nGates(), c.nInps(), (int)sizeof(GateWord) * 8);
+    printRate("mkAnd (build)", c.nGates(), time);
+    printf("| %-30s %12.1f MB %14.1f bytes/gate |\n", "memory", mem, c.size() > 0 ? mem * 1024 * 1024 / c.size() : 0);
+}
+
+//=================================================================================================
+// Batch construction (mkAnd() one pair at a time versus mkAnds()):
+//
+
+static void benchBatch(int n_ands, int n_pairs)
+{
+    double seed = 123456789;
+    Circ   c1, c2;
+    randomCirc(c1, n_ands / 16 + 2, n_ands, seed);
+    seed = 123456789;
+    randomCirc(c2, n_ands / 16 + 2, n_ands, seed);
+
+    // Random pairs of existing signals (a mix of hits and new gates):
+    vec<Sig> sigs, xs, ys, out;
+    for (GateIt git = c1.begin(); git != c1.end(); ++git)
+        sigs.push(mkSig(*git));
+    for (int i = 0; i < n_pairs; i++)
+        if (irand(seed, 2) == 0){
+            Gate g = gate(sigs[irand(seed, sigs.size())]);
+            xs.push(type(g) == gtype_And ? c1.lchild(g) : mkSig(g));
+            ys.push(type(g) == gtype_And ? c1.rchild(g) : sigs[irand(seed, sigs.size())]);
+        }else{
+            xs.push(sigs[irand(seed, sigs.size())] ^ (bool)irand(seed, 2));
+            ys.push(sigs[irand(seed, sigs.size())] ^ (bool)irand(seed, 2));
+        }
+
+    uint32_t check1 = 0, check2 = 0;
+
+    double single_time = cpuTime();
+    for (int i = 0; i < n_pairs; i++)
+        check1 += c1.mkAnd(xs[i], ys[i]).x;
+    single_time = cpuTime() - single_time;
+
+    double batch_time = cpuTime();
+    c2.mkAnds(xs, ys, out);
+    for (int i = 0; i < n_pairs; i++)
+        check2 += out[i].x;
+    batch_time = cpuTime() - batch_time;
+
+    printf("|  Gates: %12"PRIgs"    Inputs: %10d    (check %08x/%08x)  |\n", c1.nGates(), c1.nInps(), check1, check2);
+    printRate("mkAnd (one pair per call)", n_pairs, single_time);
+    printRate("mkAnds (batch)",            n_pairs, batch_time);
+}
+
+//=================================================================================================
+// Concurrent construction (copying output cones with several threads):
+//
+
+struct CopyJob {
+    const Circ*      src;
+    Circ*            dst;
+    const vec<Gate>* roots;
+    volatile int*    next_root;
+    GMap<Sig>        map;
+    vec<Gate>        stack;
+};
+
+
+static void* copyWorker(void* arg)
+{
+    CopyJob&   job = *(CopyJob*)arg;
+    const Circ& src = *job.src;
+
+    for (int i; (i = __sync_fetch_and_add(job.next_root, 1)) < job.roots->size();){
+        job.stack.clear();
+        job.stack.push((*job.roots)[i]);
+        while (job.stack.size() > 0){
+            Gate g = job.stack.last();
+            if (job.map[g] != sig_Undef){
+                job.stack.pop();
+                continue; }
+
+            Sig x  = src.lchild(g);
+            Sig y  = src.rchild(g);
+            Sig mx = job.map[gate(x)];
+            Sig my = job.map[gate(y)];
+            if (mx == sig_Undef) job.stack.push(gate(x));
+            if (my == sig_Undef) job.stack.push(gate(y));
+            if (mx != sig_Undef && my != sig_Undef){
+                job.map[g] = job.dst->mkAndConcurrent(mx ^ sign(x), my ^ sign(y));
+                if (job.map[g] == sig_Undef)
+                    return NULL; // Out of gates; reported by 'endConcurrent()'.
+                job.stack.pop();
+            }
+        }
+    }
+
+    return NULL;
+}
+
+
+static void benchCopy(int n_ands, int max_threads)
+{
+    double seed = 123456789;
+    Circ   src;
+    randomCirc(src, n_ands / 16 + 2, n_ands, seed);
+
+    vec<Gate> roots;
+    for (GateIt git = src.begin(); git != src.end(); ++git)
+        if (type(*git) == gtype_And && src.nFanouts(*git) == 0)
+            roots.push(*git);
+
+    printf("|  Gates: %12"PRIgs"    Inputs: %10d    Roots: %10d          |\n", src.nGates(), src.nInps(), roots.size());
+
+    for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2){
+        Circ      dst;
+        GMap<Sig> inp_map(src.lastGate(), sig_Undef);
+        inp_map[gate_True] = sig_True;
+        for (InpIt iit = src.inpBegin(); iit != src.inpEnd(); ++iit)
+            inp_map[*iit] = dst.mkInp(src.number(*iit));
+
+        vec<CopyJob*> jobs;
+        volatile int  next_root = 0;
+        for (int i = 0; i < n_threads; i++){
+            jobs.push(new CopyJob);
+            jobs[i]->src       = &src;
+            jobs[i]->dst       = &dst;
+            jobs[i]->roots     = &roots;
+            jobs[i]->next_root = &next_root;
+            inp_map.copyTo(jobs[i]->map);
+        }
+
+        dst.beginConcurrent(src.nGates());
+        double time = realTime();
+        vec<pthread_t> threads(n_threads);
+        for (int i = 0; i < n_threads; i++)
+            pthread_create(&threads[i], NULL, copyWorker, jobs[i]);
+        for (int i = 0; i < n_threads; i++)
+            pthread_join(threads[i], NULL);
+        time = realTime() - time;
+        if (!dst.endConcurrent())
+            fprintf(stderr, "ERROR! Too many gates created in concurrent mode.\n"), exit(1);
+
+        char what[32];
+        sprintf(what, "copy (%d threads, %"PRIgs")", n_threads, dst.nGates());
+        printRate(what, src.nGates(), time);
+
+        for (int i = 0; i < n_threads; i++)
+            delete jobs[i];
+    }
+}
+
+//=================================================================================================
+// Multi-threaded simulation:
+//
+
+static void benchSimThreads(int n_ands, int max_threads)
+{
+    double seed = 123456789;
+    Circ   c;
+    randomCirc(c, n_ands / 16 + 2, n_ands, seed);
+
+    // Few words per gate splits the levels over the threads, many words splits the patterns:
+    for (int n_words = 1; n_words <= 64; n_words *= 64){
+        CircSim sim(c, n_words);
+        sim.simulate();
+        printf("|  Gates: %12"PRIgs"    Levels: %10d    Words per gate: %5d      |\n", c.nGates(), sim.nLevels(), n_words);
+
+        int n_rounds = 64 / n_words > 4 ? 64 / n_words : 4;
+        for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2){
+            if (!sim.setThreads(n_threads)){
+                printf("| %-72s |\n", "WARNING: could not create the simulation threads.");
+                break; }
+            sim.randomizeInputs();
+            double time = realTime();
+            for (int r = 0; r < n_rounds; r++)
+                sim.simulate();
+            time = realTime() - time;
+
+            char what[32];
+            sprintf(what, "patterns (%d threads)", n_threads);
+            printRate(what, (uint64_t)n_rounds * sim.nPatterns(), time);
+        }
+    }
+}
+
+//=================================================================================================
+// Ternary simulation:
+//
+
+static void benchTernary(int n_ands, int n_frames)
+{
+    double  seed = 123456789;
+    SeqCirc sc;
+    randomCirc(sc.main, n_ands / 16 + 2, n_ands, seed);
+
+    // Make half of the inputs flops, with random next-state functions and a mix of constant and
+    // X-initialization:
+    vec<Sig> sigs;
+    for (GateIt git = sc.main.begin(); git != sc.main.end(); ++git)
+        sigs.push(mkSig(*git));
+    int n_inps = 0;
+    for (InpIt iit = sc.main.inpBegin(); iit != sc.main.inpEnd(); ++iit)
+        if (n_inps++ % 2 == 0){
+            Sig init = irand(seed, 4) == 0 ? sc.init.mkInp() : irand(seed, 2) ? sig_True : sig_False;
+            sc.flps.define(*iit, sigs[irand(seed, sigs.size())] ^ (bool)irand(seed, 2), init);
+        }
+
+    TernSim ts(sc);
+    double  time = cpuTime();
+    ts.reset();
+    for (int i = 0; i < n_frames && !ts.cycleFound(); i++)
+        ts.step();
+    time = cpuTime() - time;
+
+    int n_const = 0;
+    if (ts.cycleFound())
+        for (int i = 0; i < sc.flps.size(); i++)
+            n_const += ts.constValue(i) != l_Undef;
+
+    printf("|  Gates: %12"PRIgs"    Flops: %10d    Constant flops: %10d  |\n", sc.main.nGates(), sc.flps.size(), n_const);
+    printRate("gate-cycles", (uint64_t)sc.main.nGates() * ts.nFrames(), time);
+}
+
+//=================================================================================================
+// Gate ordering (simulation speed before and after 'reorder()'):
+//
+
+// Build a circuit of 'n_cones' independent cones whose gates are created interleaved, so that the
+// children of a gate are typically far away from it (similar to what 'dagShrink()' or reading
+// an AIGER file may produce):
+static void interleavedCirc(Circ& c, int n_inps, int n_ands, int n_cones, double& seed, vec<Sig>& outs)
+{
+    vec<vec<Sig> > cones(n_cones);
+    for (int i = 0; i < n_inps; i++)
+        cones[i % n_cones].push(c.mkInp());
+
+    while (c.nGates() < n_ands){
+        vec<Sig>& xs = cones[irand(seed, n_cones)];
+        Sig x = randomSig(seed, xs);
+        Sig y = randomSig(seed, xs);
+        int n = c.nGates();
+        Sig z = c.mkAnd(x, y);
+        if (c.nGates() > n)
+            xs.push(z);
+    }
+
+    for (GateIt git = c.begin(); git != c.end(); ++git)
+        if (type(*git) == gtype_And && c.nFanouts(*git) == 0)
+            outs.push(mkSig(*git));
+}
+
+
+// Simulate 64 random patterns 'n_rounds' times, visiting the gates in order. The patterns are
+// given to the inputs in the order of 'inps':
+static uint64_t simulate(const Circ& c, const vec<Gate>& inps, int n_rounds, double& seed)
+{
+    GMap<uint64_t> val(c.lastGate(), 0);
+    val[gate_True] = ~(uint64_t)0;
+
+    uint64_t check = 0;
+    for (int r = 0; r < n_rounds; r++){
+        for (int i = 0; i < inps.size(); i++)
+            val[inps[i]] = ((uint64_t)irand(seed, 1 << 30) << 34) ^ ((uint64_t)irand(seed, 1 << 30) << 17) ^ irand(seed, 1 << 30);
+
+        for (GateIt git = c.begin(); git != c.end(); ++git){
+            Gate g = *git;
+            if (type(g) != gtype_And)
+                continue;
+            Sig x = c.lchild(g);
+            Sig y = c.rchild(g);
+            val[g] = (val[gate(x)] ^ -(uint64_t)sign(x)) & (val[gate(y)] ^ -(uint64_t)sign(y));
+            check += val[g];
+        }
+    }
+    return check;
+}
+
+
+static void benchOrder(int n_ands, int n_rounds)
+{
+    double   seed = 123456789;
+    Circ     c;
+    vec<Sig> outs;
+    interleavedCirc(c, n_ands / 16 + 2, n_ands, 64, seed, outs);
+
+    vec<Gate> inps;
+    for (InpIt iit = c.inpBegin(); iit != c.inpEnd(); ++iit)
+        inps.push(*iit);
+
+    double   sim_seed = 42;
+    double   sim_time = cpuTime();
+    uint64_t check    = simulate(c, inps, n_rounds, sim_seed);
+    sim_time = cpuTime() - sim_time;
+
+    GMap<Sig> remap;
+    double    reorder_time = cpuTime();
+    c.reorder(outs, remap);
+    reorder_time = cpuTime() - reorder_time;
+
+    // Give the same patterns to the renumbered inputs (which are no longer iterated in the same order):
+    for (int i = 0; i < inps.size(); i++)
+        inps[i] = gate(remap[inps[i]]);
+    sim_seed = 42;
+    double   sim2_time = cpuTime();
+    uint64_t check2    = simulate(c, inps, n_rounds, sim_seed);
+    sim2_time = cpuTime() - sim2_time;
+
+    printf("|  Gates: %12"PRIgs"    Inputs: %10d    Outputs: %10d        |\n", c.nGates(), c.nInps(), outs.size());
+    printRate("simulate (original)",  (uint64_t)c.nGates() * n_rounds, sim_time);
+    printRate("reorder",              c.size(),                       reorder_time);
+    printRate("simulate (reordered)", (uint64_t)c.nGates() * n_rounds, sim2_time);
+    if (check != check2)
+        printf("| %-72s |\n", "WARNING: simulation results differ!");
+}
+
+//=================================================================================================
+// Bit-parallel simulation (compared to 'evaluate()'):
+//
+
+static void benchSim(int n_ands, int n_patterns)
+{
+    double seed = 123456789;
+    Circ   c;
+    randomCirc(c, n_ands / 16 + 2, n_ands, seed);
+    printf("|  Gates: %12"PRIgs"    Inputs: %10d                               |\n", c.nGates(), c.nInps());
+
+    // Reference: one pattern at a time with 'evaluate()'. Gates are visited in order so that the
+    // recursion never goes deeper than one level:
+    int         n_eval = n_patterns < 64 ? n_patterns : 64;
+    CircSim     sim(c, 1);
+    GMap<lbool> values;
+    bool        ok           = true;
+    uint64_t    scalar_check = 0;
+    sim.randomizeInputs();
+    sim.simulate();
+    double eval_time = cpuTime();
+    for (int k = 0; k < n_eval; k++){
+        values.clear();
+        values.growTo(c.lastGate(), l_Undef);
+        values[gate_True] = l_True;
+        for (InpIt iit = c.inpBegin(); iit != c.inpEnd(); ++iit)
+            values[*iit] = lbool(sim.value(mkSig(*iit), k));
+        for (GateIt git = c.begin(); git != c.end(); ++git)
+            ok &= evaluate(c, mkSig(*git), values) == sim.value(mkSig(*git), k);
+    }
+    eval_time = cpuTime() - eval_time;
+    printRate("evaluate (gates * patterns)", (uint64_t)c.nGates() * n_eval, eval_time);
+
+    // All kernels simulate the same patterns, and must agree on the result:
+    for (int n_words = 1; n_words <= 32; n_words = n_words == 1 ? 8 : n_words * 4)
+        for (int k = CircSim::kernel_Scalar; k <= CircSim::kernel_Avx512; k++){
+            CircSim wsim(c, n_words);
+            if (!wsim.setKernel((CircSim::Kernel)k))
+                continue;
+
+            int      n_rounds = (n_patterns + wsim.nPatterns() - 1) / wsim.nPatterns();
+            uint64_t check    = 0;
+            double   time     = cpuTime();
+            for (int r = 0; r < n_rounds; r++){
+                wsim.randomizeInputs();
+                wsim.simulate();
+                check ^= wsim.signature(c.lastGate());
+            }
+            time = cpuTime() - time;
+            if (k == CircSim::kernel_Scalar)
+                scalar_check = check;
+            else
+                ok &= check == scalar_check;
+
+            char what[32];
+            sprintf(what, "CircSim (%s, %d words)", CircSim::kernelName((CircSim::Kernel)k), n_words);
+            printRate(what, (uint64_t)c.nGates() * n_rounds * wsim.nPatterns(), time);
+        }
+
+    if (!ok)
+        printf("| %-72s |\n", "WARNING: simulation results differ!");
+}
+
+//=================================================================================================
+// SAT sweeping with and without solver recycling:
+//
+
+struct SweepCount { uint64_t queries; int recycles; };
+
+static void countRound(const SweepStats& st, void* data)
+{
+    SweepCount* count = (SweepCount*)data;
+    count->queries  += st.sat_queries + st.unsat_queries + st.undecided_queries;
+    count->recycles += st.recycles;
+}
+
+
+// Sweep the simulation classes of a random circuit with 'n_ands' gates, where half of the gates
+// are associative restructurings of the other half. The second run recycles its solver when it
+// has more than 1/'n_recycles' of the clauses that the first run ended with, and must prove the
+// same equivalences:
+static void benchSweep(int n_ands, int n_recycles)
+{
+    double   seed = 123456789;
+    Circ     c;
+    vec<Sig> xs;
+    randomCirc(c, n_ands / 16 + 2, n_ands / 2, seed);
+    for (GateIt git = c.begin(); git != c.end(); ++git)
+        xs.push(mkSig(*git));
+    while (c.nGates() < n_ands){
+        Sig x = randomSig(seed, xs);
+        Sig y = randomSig(seed, xs);
+        Sig z = randomSig(seed, xs);
+        xs.push(c.mkAnd(c.mkAnd(x, y), z));
+        xs.push(c.mkAnd(x, c.mkAnd(y, z)));
+    }
+
+    // Few patterns leave many false candidates, so that there are many queries:
+    Eqs cands;
+    makeSimClasses(c, cands, 1);
+    printf("|  Gates: %12"PRIgs"    Inputs: %10d    Classes: %10d        |\n", c.nGates(), c.nInps(), cands.size());
+
+    Equivs  proven[2];
+    int64_t n_clauses = 0;
+    for (int r = 0; r < 2; r++){
+        SimpSolver             s;
+        Clausifyer<SimpSolver> cl(c, s);
+        SweepBudget            budget;
+        SweepCount             count = { 0, 0 };
+        Eqs                    eqs_out;
+        if (r == 1)
+            budget.recycle_clauses = n_clauses / n_recycles;
+
+        double time = cpuTime();
+        satSweep(c, cl, s, cands, eqs_out, 0, budget, countRound, &count);
+        time = cpuTime() - time;
+        if (r == 0)
+            n_clauses = s.nClauses() + s.nLearnts();
+        for (int i = 0; i < eqs_out.size(); i++)
+            for (int j = 1; j < eqs_out[i].size(); j++)
+                proven[r].merge(eqs_out[i][0], eqs_out[i][j]);
+
+        char what[32];
+        sprintf(what, "queries (%d recycles)", count.recycles);
+        printRate(what, count.queries, time);
+    }
+
+    // Both runs must prove exactly the same equivalences:
+    bool ok = true;
+    for (int r = 0; r < 2; r++)
+        for (uint32_t i = 0; i < proven[r].size(); i++)
+            for (int j = 1; j < proven[r][i].size(); j++)
+                ok &= proven[1-r].equals(proven[r][i][0], proven[r][i][j]);
+    if (!ok)
+        printf("| %-72s |\n", "WARNING: recycling changed the proven equivalences!");
+}
+
+//=================================================================================================
+// Main:
+//
+
+static void printUsage(const char* prog)
+{
+    fprintf(stderr, "USAGE: %s <benchmark> [<size> [<queries>|<threads>|<rounds>]]\n\n", prog);
+    fprintf(stderr, "  strash     Structural hashing (mkAnd, tryAnd) per second.\n");
+    fprintf(stderr, "  gates      Circuit construction (mkAnd) speed and memory per gate.\n");
+    fprintf(stderr, "  batch      Gate construction with mkAnd() per pair versus one call to mkAnds().\n");
+    fprintf(stderr, "  copy       Concurrent copying of all output cones with 1, 2, 4, .. <threads> threads.\n");
+    fprintf(stderr, "  sim        Simulation of <queries> patterns with each CircSim kernel, compared to evaluate().\n");
+    fprintf(stderr, "  simmt      Simulation speed with 1, 2, 4, .. <threads> threads.\n");
+    fprintf(stderr, "  tern       Ternary simulation of up to <queries> frames, until the states repeat.\n");
+    fprintf(stderr, "  order      Simulation speed before and after depth-first reordering of the gates.\n");
+    fprintf(stderr, "  sweep      SAT sweeping without, and with solver recycling at 1/<rounds> of the clauses.\n");
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2){
+        printUsage(argv[0]);
+        exit(1); }
+
+    int size    = argc > 2 ? atoi(argv[2]) : 4000000;
+    int queries = argc > 3 ? atoi(argv[3]) : 10000000;
+
+    printf("============================================================================\n");
+    if (strcmp(argv[1], "strash") == 0)
+        benchStrash(size, queries);
+    else if (strcmp(argv[1], "gates") == 0)
+        benchGates(size);
+    else if (strcmp(argv[1], "batch") == 0)
+        benchBatch(size, queries);
+    else if (strcmp(argv[1], "copy") == 0)
+        benchCopy(size, argc > 3 ? queries : 8);
+    else if (strcmp(argv[1], "sim") == 0)
+        benchSim(size, argc > 3 ? queries : 1024);
+    else if (strcmp(argv[1], "simmt") == 0)
+        benchSimThreads(size, argc > 3 ? queries : 8);
+    else if (strcmp(argv[1], "tern") == 0)
+        benchTernary(size, argc > 3 ? queries : 100);
+    else if (strcmp(argv[1], "order") == 0)
+        benchOrder(size, argc > 3 ? queries : 20);
+    else if (strcmp(argv[1], "sweep") == 0){
+        if (argc > 3 && queries <= 0)
+            fprintf(stderr, "ERROR! The number of <rounds> must be positive.\n"), exit(1);
+        benchSweep(argc > 2 ? size : 100000, argc > 3 ? queries : 8);
+    }else{
+        printUsage(argv[0]);
+        exit(1); }
+    printf("============================================================================\n");
+
+    return 0;
+}
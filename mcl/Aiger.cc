@@ -109,6 +109,7 @@ void Minisat::readAiger(const char* filename, SeqCirc& c, vec<Sig>& outs)
         fprintf(stderr, "ERROR! Header mismatching sizes (M != I + L + A)\n"), exit(1);
 
     c.clear();
+    c.main.reserve(max_var);
     outs.clear();
 
     vec<Sig> id2sig(max_var+1, sig_Undef);
@@ -334,6 +335,7 @@ void Minisat::readAiger_v19(const char* filename, SeqCirc& c, AigerSections& sec
         fprintf(stderr, "ERROR! Header mismatching sizes (M != I + L + A)\n"), exit(1);
 
     c           .clear();
+    c.main      .reserve(max_var);
     sects.outs  .clear();
     sects.cnstrs.clear();
     sects.fairs .clear();
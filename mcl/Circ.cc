@@ -36,143 +36,605 @@ static IntOption opt_rewrite_mode (_cat, "rw-mode", "Rewrite level. 0=None, 1=St
 
 
 Circ::Circ() 
-    : n_inps       (0) 
-    , n_ands       (0)
-    , strash       (NULL)
-    , strash_cap   (0)
-    , tmp_gate     (gate_True)
-    , rewrite_mode (opt_rewrite_mode)
+    : n_ands         (0)
+    , strash         (NULL)
+    , strash_cap     (0)
+    , strash_old     (NULL)
+    , strash_old_cap (0)
+    , strash_moved   (0)
+    , has_fanouts    (false)
+    , fanout_built   (0)
+    , shards         (NULL)
+    , conc_next      (0)
+    , conc_lim       (0)
+    , conc_full      (false)
+    , conc_fanouts   (false)
+    , rewrite_mode   (opt_rewrite_mode)
 { 
-    gates.growTo(tmp_gate); 
-    n_fanouts.growTo(tmp_gate, 0);
+    gate_x.growTo(gate_True); 
+    gate_y.growTo(gate_True); 
+    and_bits.growTo(1, 0);
+    n_fanouts.growTo(gate_True, 0);
     restrashAll();
-    gates[tmp_gate].strash_next = gate_Undef;
 }
 
 
 Circ::~Circ()
 {
-    if (strash) free(strash);
+    if (shards)     endConcurrent();
+    if (strash)     free(strash);
+    if (strash_old) free(strash_old);
 }
 
 
 void Circ::clear()
 {
-    gates.clear();
+    assert(!isConcurrent());
+    gate_x.clear();
+    gate_y.clear();
+    and_bits.clear();
+    inps.clear();
     n_fanouts.clear();
-    n_inps = 0;
     n_ands = 0;
-    if (strash) free(strash);
-    strash = NULL;
-    strash_cap = 0;
+    clearFanouts();
     
-    gates.growTo(tmp_gate); 
-    n_fanouts.growTo(tmp_gate, 0);
+    gate_x.growTo(gate_True); 
+    gate_y.growTo(gate_True); 
+    and_bits.growTo(1, 0);
+    n_fanouts.growTo(gate_True, 0);
     restrashAll();
-    gates[tmp_gate].strash_next = gate_Undef;
 }
 
 
 void Circ::moveTo(Circ& to)
 {
-    gates.moveTo(to.gates);
+    assert(!isConcurrent());
+    assert(!to.isConcurrent());
+    gate_x.moveTo(to.gate_x);
+    gate_y.moveTo(to.gate_y);
+    and_bits.moveTo(to.and_bits);
+    inps.moveTo(to.inps);
     n_fanouts.moveTo(to.n_fanouts);
-    to.n_inps = n_inps;
     to.n_ands = n_ands;
-    if (to.strash) free(to.strash);
-    to.strash = strash;
-    to.strash_cap = strash_cap;
+    if (to.strash)     free(to.strash);
+    if (to.strash_old) free(to.strash_old);
+    to.strash         = strash;
+    to.strash_cap     = strash_cap;
+    to.strash_old     = strash_old;
+    to.strash_old_cap = strash_old_cap;
+    to.strash_moved   = strash_moved;
+
+    to.has_fanouts    = has_fanouts;
+    to.fanout_built   = fanout_built;
+    fanout_begin.moveTo(to.fanout_begin);
+    fanout_end  .moveTo(to.fanout_end);
+#ifdef MCL_WIDE_GATES
+    vecMoveTo(fanout_edges, to.fanout_edges);
+#else
+    fanout_edges.moveTo(to.fanout_edges);
+#endif
+    fanout_head .moveTo(to.fanout_head);
+    fanout_links.moveTo(to.fanout_links);
+    has_fanouts    = false;
+    fanout_built   = 0;
+
+    n_ands         = 0;
+    strash         = NULL;
+    strash_cap     = 0;
+    strash_old     = NULL;
+    strash_old_cap = 0;
+    strash_moved   = 0;
+
+    gate_x.growTo(gate_True); 
+    gate_y.growTo(gate_True); 
+    and_bits.growTo(1, 0);
+    n_fanouts.growTo(gate_True, 0);
+    restrashAll();
+}
+
+
+void Circ::reserve(GateWord n_gates)
+{
+    reserveGates(n_gates);
+    if (strash_cap / 2 < n_gates + 1)
+        restrashAll(n_gates);
+}
+
+
+// Pre-size the per-gate arrays only (the strash table is left to grow incrementally):
+void Circ::reserveGates(GateWord n_gates)
+{
+    Gate g = mkGate(n_gates, gtype_Inp);
+    gate_x.reserve(g);
+    gate_y.reserve(g);
+    and_bits.capacity((n_gates >> 5) + 1);
+    n_fanouts.reserve(g);
+    if (has_fanouts){
+        fanout_begin.reserve(g);
+        fanout_end  .reserve(g);
+        fanout_head .reserve(g);
+    }
+}
+
+
+void Circ::compact(const vec<Sig>& roots, GMap<Sig>& remap)
+{
+    assert(gate_lim.size() == 0);
+    assert(!isConcurrent());
+
+    // Mark gates reachable from 'roots', and remove the fanouts of all other gates:
+    GMap<char> reached(lastGate(), 0);
+    for (int i = 0; i < roots.size(); i++)
+        if (roots[i] != sig_Undef)
+            reached[gate(roots[i])] = 1;
+
+    GateWord n_reached = 0;
+    for (GateWord id = gate_x.size()-1; id > 0; id--){
+        Gate g = gateFromId(id);
+        if (type(g) != gtype_And)
+            continue;
+        else if (reached[g]){
+            reached[gate(gate_x[g])] = 1;
+            reached[gate(gate_y[g])] = 1;
+            n_reached++;
+        }else{
+            n_fanouts[gate(gate_x[g])]--;
+            n_fanouts[gate(gate_y[g])]--;
+        }
+    }
+
+    // Slide remaining gates down (keeping their relative order, so children stay normalized), and
+    // strash them into a fresh table:
+    strashAlloc(n_reached);
+    n_ands = n_reached;
+    remap.clear();
+    remap.growTo(lastGate(), sig_Undef);
+    remap[gate_True] = sig_True;
+
+    GateWord n_gates = 1;
+    for (GateWord id = 1; id < (GateWord)gate_x.size(); id++){
+        Gate g = gateFromId(id);
+        if (type(g) == gtype_And && !reached[g])
+            continue;
+
+        Gate h = mkGate(n_gates, type(g));
+        if (type(g) == gtype_And){
+            Sig x = remap[gate(gate_x[g])] ^ sign(gate_x[g]);
+            Sig y = remap[gate(gate_y[g])] ^ sign(gate_y[g]);
+            gate_x[h] = x;
+            gate_y[h] = y;
+            and_bits[n_gates >> 5] |=  (1U << (n_gates & 31));
+            strashPut(strash, strash_cap, strashHash(x, y), h);
+        }else{
+            gate_x[h] = gate_x[g];
+            gate_y[h] = gate_y[g];
+            and_bits[n_gates >> 5] &= ~(1U << (n_gates & 31));
+        }
+        n_fanouts[h] = n_fanouts[g];
+        remap[g]     = mkSig(h);
+        n_gates++;
+    }
+
+    gate_x   .shrink(gate_x.size()    - n_gates);
+    gate_y   .shrink(gate_y.size()    - n_gates);
+    n_fanouts.shrink(n_fanouts.size() - n_gates);
+    for (int i = 0; i < inps.size(); i++)
+        inps[i] = gate(remap[inps[i]]);
+
+    if (has_fanouts)
+        buildFanouts();
+}
 
-    n_inps = 0;
-    n_ands = 0;
-    strash = NULL;
-    strash_cap = 0;
 
-    gates.growTo(tmp_gate); 
-    n_fanouts.growTo(tmp_gate, 0);
+void Circ::reorder(const vec<Sig>& roots, GMap<Sig>& remap)
+{
+    assert(gate_lim.size() == 0);
+    assert(!isConcurrent());
+
+    // Number gates in depth-first post-order, starting with the cones of 'roots' and then the cones
+    // of all remaining gates in their current order:
+    remap.clear();
+    remap.growTo(lastGate(), sig_Undef);
+    remap[gate_True] = sig_True;
+
+    vec<Gate> stack;
+    GateWord  n_gates = 1;
+    GateWord  n_start = roots.size() + gate_x.size() - 1;
+    for (GateWord i = 0; i < n_start; i++){
+        if (i < (GateWord)roots.size() && roots[i] == sig_Undef)
+            continue;
+
+        stack.push(i < (GateWord)roots.size() ? gate(roots[i]) : gateFromId(i - roots.size() + 1));
+        while (stack.size() > 0){
+            Gate g = stack.last();
+            if (remap[g] != sig_Undef){
+                stack.pop();
+                continue; }
+
+            Gate x = type(g) == gtype_And ? gate(gate_x[g]) : gate_True;
+            Gate y = type(g) == gtype_And ? gate(gate_y[g]) : gate_True;
+            if (remap[y] == sig_Undef) stack.push(y);
+            if (remap[x] == sig_Undef) stack.push(x);
+            if (remap[x] != sig_Undef && remap[y] != sig_Undef){
+                remap[g] = mkSig(mkGate(n_gates++, type(g)));
+                stack.pop();
+            }
+        }
+    }
+    assert(n_gates == (GateWord)gate_x.size());
+
+    // Copy gate data into the new order:
+    GMap<Sig>      new_x;
+    GMap<Sig>      new_y;
+    GMap<uint32_t> new_fanouts;
+    vec<uint32_t>  new_bits;
+    new_x      .growTo(lastGate());
+    new_y      .growTo(lastGate());
+    new_fanouts.growTo(lastGate(), 0);
+    new_bits   .growTo(and_bits.size(), 0);
+
+    for (GateWord id = 1; id < (GateWord)gate_x.size(); id++){
+        Gate     g = gateFromId(id);
+        Gate     h = gate(remap[g]);
+        GateWord j = index(h);
+        if (type(g) == gtype_And){
+            Sig x = remap[gate(gate_x[g])] ^ sign(gate_x[g]);
+            Sig y = remap[gate(gate_y[g])] ^ sign(gate_y[g]);
+            if (rewrite_mode >= 1 && y < x){ Sig tmp = x; x = y; y = tmp; }
+            new_x[h] = x;
+            new_y[h] = y;
+            new_bits[j >> 5] |= (1U << (j & 31));
+        }else{
+            new_x[h] = gate_x[g];
+            new_y[h] = gate_y[g];
+        }
+        new_fanouts[h] = n_fanouts[g];
+    }
+
+    new_x      .moveTo(gate_x);
+    new_y      .moveTo(gate_y);
+    new_fanouts.moveTo(n_fanouts);
+    new_bits   .moveTo(and_bits);
+    for (int i = 0; i < inps.size(); i++)
+        inps[i] = gate(remap[inps[i]]);
+    sort(inps);
+
     restrashAll();
-    gates[tmp_gate].strash_next = gate_Undef;
+    if (has_fanouts)
+        buildFanouts();
 }
 
 
-void Circ::push()  { gate_lim.push(gates.size()); }
+// Create the and-gates 'xs[i] & ys[i]' for all 'i', storing the results in 'out'. The pairs are
+// handled in blocks: the children of all pairs in a block are prefetched, then all pairs are
+// rewritten and their strash cells prefetched, and last the gates are looked up or created.
+void Circ::mkAnds(const vec<Sig>& xs, const vec<Sig>& ys, vec<Sig>& out)
+{
+    assert(xs.size() == ys.size());
+    assert(!isConcurrent());
+    const int block = 64;
+
+    // Make room for all gates of the batch at once. The strash table is not pre-sized here, since
+    // a synchronous rehash would defeat the incremental migration in 'mkAndNode()':
+    reserveGates(gate_x.size() + xs.size());
+    if (has_fanouts)
+        fanout_links.capacity(fanout_links.size() + 2 * xs.size());
+
+    out.clear();
+    out.growTo(xs.size(), sig_Undef);
+    Sig bx[block], by[block];
+    for (int i = 0; i < xs.size(); i += block){
+        int n = xs.size() - i < block ? xs.size() - i : block;
+
+        for (int j = 0; j < n; j++){
+            __builtin_prefetch(&gate_x[gate(xs[i+j])]);
+            __builtin_prefetch(&gate_x[gate(ys[i+j])]);
+            __builtin_prefetch(&gate_y[gate(xs[i+j])]);
+            __builtin_prefetch(&gate_y[gate(ys[i+j])]);
+        }
+
+        for (int j = 0; j < n; j++){
+            bx[j] = xs[i+j];
+            by[j] = ys[i+j];
+            out[i+j] = rewriteAnd(bx[j], by[j]);
+            if (out[i+j] == sig_Undef && rewrite_mode >= 1)
+                __builtin_prefetch(&strash[strashHash(bx[j], by[j]) & (strash_cap - 1)]);
+        }
+
+        for (int j = 0; j < n; j++)
+            if (out[i+j] == sig_Undef)
+                out[i+j] = mkAndNode(bx[j], by[j]);
+    }
+}
+
+
+void Circ::push()  { gate_lim.push(gate_x.size()); }
 void Circ::commit(){ gate_lim.pop(); }
 void Circ::pop()
 {
     assert(gate_lim.size() > 0);
-    while ((uint32_t)gates.size() > gate_lim.last()){
+    while ((GateWord)gate_x.size() > gate_lim.last()){
         Gate g = lastGate();
         if (type(g) == gtype_And){
-            strashRemove(mkGate(gates.size()-1, gtype_And));
+            strashRemove(g);
 
             // Update fanout counters:
-            if (n_fanouts[gate(lchild(g))] < 255) n_fanouts[gate(lchild(g))]--; // else fprintf(stderr, "WARNING! fanout counter size exceded.\n");
-            if (n_fanouts[gate(rchild(g))] < 255) n_fanouts[gate(rchild(g))]--; // else fprintf(stderr, "WARNING! fanout counter size exceded.\n");
+            n_fanouts[gate(lchild(g))]--;
+            n_fanouts[gate(rchild(g))]--;
+            if (has_fanouts)
+                fanoutRemove(g);
             
             n_ands--;
-        }else
-            n_inps--;
-        gates.shrink(1);
+        }else{
+            assert(inps.last() == g);
+            inps.pop();
+        }
+        gate_x.shrink(1);
+        gate_y.shrink(1);
     }
     gate_lim.pop();
 }
 
 
-void Circ::restrashAll()
+// Build the fanout index in one linear pass. Since gates are visited in order, the fanouts of each
+// gate end up sorted, which is what allows 'pop()' to remove them from the back.
+void Circ::buildFanouts()
 {
-#if 1
-    static const unsigned int nprimes   = 47;
-    static const unsigned int primes [] = { 31, 47, 71, 107, 163, 251, 379, 569, 853, 1279, 1931, 2897, 4349, 6529, 9803, 14713, 22073, 33113, 49669, 74507, 111767, 167663, 251501, 377257, 565889, 848839, 1273267, 1909907, 2864867, 4297301, 6445951, 9668933, 14503417, 21755137, 32632727, 48949091, 73423639, 110135461, 165203191, 247804789, 371707213, 557560837, 836341273, 1254511933, 1881767929, 2822651917U, 4233977921U };
-#else
-    static const unsigned int nprimes   = 26;
-    static const unsigned int primes [] = {
-          53
-        , 97
-        , 193
-        , 389
-        , 769
-        , 1543
-        , 3079
-        , 6151
-        , 12289
-        , 24593
-        , 49157
-        , 98317
-        , 196613
-        , 393241
-        , 786433
-        , 1572869
-        , 3145739
-        , 6291469
-        , 12582917
-        , 25165843
-        , 50331653
-        , 100663319
-        , 201326611
-        , 402653189
-        , 805306457
-        , 1610612741
-    };
+    Gate last = lastGate();
+    fanout_begin.clear(); fanout_begin.growTo(last, 0);
+    fanout_end  .clear(); fanout_end  .growTo(last, 0);
+    fanout_head .clear(); fanout_head .growTo(last, link_Undef);
+    fanout_links.clear();
+
+    // Count fanouts:
+    for (Gate g = firstGate(); g != gate_Undef; g = nextGate(g))
+        if (type(g) == gtype_And){
+            fanout_end[gate(gate_x[g])]++;
+            fanout_end[gate(gate_y[g])]++; }
+
+    // Compute ranges:
+    GateSize n_edges = 0;
+    for (GateSize i = 0; i < gate_x.size(); i++){
+        Gate g = gateFromId(i);
+        fanout_begin[g] = n_edges;
+        n_edges        += fanout_end[g];
+        fanout_end[g]   = fanout_begin[g];
+    }
+
+    // Fill in edges:
+    fanout_edges.clear();
+    fanout_edges.growTo(n_edges);
+    for (Gate g = firstGate(); g != gate_Undef; g = nextGate(g))
+        if (type(g) == gtype_And){
+            fanout_edges[fanout_end[gate(gate_x[g])]++] = g;
+            fanout_edges[fanout_end[gate(gate_y[g])]++] = g; }
+
+    has_fanouts  = true;
+    fanout_built = gate_x.size();
+}
+
+
+void Circ::clearFanouts()
+{
+    fanout_begin.clear(true);
+    fanout_end  .clear(true);
+    fanout_edges.clear(true);
+    fanout_head .clear(true);
+    fanout_links.clear(true);
+    has_fanouts  = false;
+    fanout_built = 0;
+}
+
+
+// Remove the fanout edges of the last gate 'g' (called by 'pop()'):
+void Circ::fanoutRemove(Gate g)
+{
+    Gate x = gate(gate_x[g]);
+    Gate y = gate(gate_y[g]);
+
+    if (index(g) < fanout_built){
+        // 'g' is the last fanout in the ranges of its children:
+        assert(fanout_edges[fanout_end[y]-1] == g); fanout_end[y]--;
+        assert(fanout_edges[fanout_end[x]-1] == g); fanout_end[x]--;
+        fanout_built = index(g);
+    }else{
+        // 'g' was the last gate added, so its links are on top:
+        assert(fanout_links.last().g == g); fanout_head[y] = fanout_links.last().next; fanout_links.pop();
+        assert(fanout_links.last().g == g); fanout_head[x] = fanout_links.last().next; fanout_links.pop();
+    }
+}
 
-#endif
 
-    // Find new size:
-    unsigned int oldsize = strash_cap;
-    strash_cap  = primes[0];
-    for (unsigned int i = 1; strash_cap <= oldsize && i < nprimes; i++)
-        strash_cap = primes[i];
+// Allocate a zero-initialized table. Untouched pages are provided lazily by the OS, so this is
+// cheap also for big tables:
+static void* zalloc(size_t n, size_t size)
+{
+    void* mem = calloc(n, size);
+    if (mem == NULL && n > 0) throw OutOfMemoryException();
+    return mem;
+}
+
+
+// Start using a table of twice the size. The cells of the old table are moved over gradually as new
+// gates are inserted (see 'strashMigrate()'), such that no single call to 'mkAnd()' pays for
+// rehashing the whole circuit.
+void Circ::strashGrow()
+{
+    // Finish any ongoing migration first (normally already done by now):
+    strashMigrate(strash_old_cap);
+
+    strash_old     = strash;
+    strash_old_cap = strash_cap;
+    strash_moved   = 0;
+    strash_cap    *= 2;
+    strash         = (StrashCell*)zalloc(strash_cap, sizeof(StrashCell));
+}
+
 
-    // printf("New strash size: %d\n", strash_cap);
+// Replace the table(s) with an empty one that has room for 'n' and-gates:
+void Circ::strashAlloc(GateWord n)
+{
+    // Find new size (keeping the load factor at most 1/2):
+    GateWord newsize = 32;
+    while (newsize / 2 < n + 1)
+        newsize *= 2;
+
+    // printf("New strash size: %d\n", newsize);
+
+    if (strash)     free(strash);
+    if (strash_old) free(strash_old);
+    strash         = (StrashCell*)zalloc(newsize, sizeof(StrashCell));
+    strash_cap     = newsize;
+    strash_old     = NULL;
+    strash_old_cap = 0;
+    strash_moved   = 0;
+}
 
-    // Allocate and initialize memory for new table:
-    strash = (Gate*)xrealloc(strash, sizeof(Gate) * strash_cap);
-    for (unsigned int i = 0; i < strash_cap; i++)
-        strash[i] = gate_Undef;
+
+// Rebuild the table from scratch with room for at least 'n_min' and-gates:
+void Circ::restrashAll(GateWord n_min)
+{
+    strashAlloc(n_ands > n_min ? n_ands : n_min);
 
     // Rehash active and-nodes into new table:
     for (Gate g = firstGate(); g != gate_Undef; g = nextGate(g))
         if (type(g) == gtype_And) 
+            strashPut(strash, strash_cap, strashHash(gate_x[g], gate_y[g]), g);
+}
+
+
+//=================================================================================================
+// Concurrent construction:
+//
+//   New gates get their ids from an atomic counter, and are strashed in one of several separately
+//   locked tables (selected by the top bits of the hash). Gates that existed before are found in the
+//   main table, which is read-only in this mode. The arrays of gate data are grown up front, so that
+//   they are never reallocated while other threads read them.
+
+
+void Circ::beginConcurrent(GateWord n_max)
+{
+    assert(!isConcurrent());
+    assert(gate_lim.size() == 0);
+
+    GateWord start = gate_x.size();
+    conc_next = start;
+    conc_lim  = start + n_max;
+    conc_full = false;
+
+    Gate last = mkGate(conc_lim - 1, gtype_And);
+    gate_x   .growTo(last);
+    gate_y   .growTo(last);
+    n_fanouts.growTo(last, 0);
+    and_bits .growTo((conc_lim >> 5) + 1, 0);
+    and_bits[start >> 5] &= (1U << (start & 31)) - 1; // Bits of popped gates may remain here.
+
+    // The fanout index is rebuilt afterwards instead:
+    conc_fanouts = has_fanouts;
+    if (has_fanouts)
+        clearFanouts();
+
+    shards = (StrashShard*)zalloc(strash_shards, sizeof(StrashShard));
+    for (unsigned int i = 0; i < strash_shards; i++){
+        pthread_mutex_init(&shards[i].lock, NULL);
+        shards[i].cap = 32;
+        shards[i].tab = (StrashCell*)zalloc(shards[i].cap, sizeof(StrashCell));
+    }
+}
+
+
+bool Circ::endConcurrent()
+{
+    assert(isConcurrent());
+
+    for (unsigned int i = 0; i < strash_shards; i++){
+        pthread_mutex_destroy(&shards[i].lock);
+        free(shards[i].tab);
+    }
+    free(shards);
+    shards = NULL;
+
+    // Shrink to the gates actually created, and move them into the main table:
+    if (conc_next > conc_lim)
+        conc_next = conc_lim;
+    GateWord start = n_ands + inps.size() + 1;
+    gate_x.shrink(gate_x.size() - conc_next);
+    gate_y.shrink(gate_y.size() - conc_next);
+    for (GateWord id = start; id < conc_next; id++){
+        Gate g = mkGate(id, gtype_And);
+        n_ands++;
+        if (rewrite_mode >= 1){
+            if (n_ands > strash_cap / 2)
+                strashGrow();
             strashInsert(g);
+        }
+    }
+
+    if (conc_fanouts)
+        buildFanouts();
+
+    return !conc_full;
+}
+
+
+Sig Circ::mkAndConcurrent(Sig x, Sig y)
+{
+    assert(isConcurrent());
+    if (x == sig_Undef || y == sig_Undef)
+        return sig_Undef;
+
+    Sig z = rewriteAnd(x, y);
+    if (z != sig_Undef)
+        return z;
+
+    StrashShard* sh = NULL;
+    if (rewrite_mode >= 1){
+        Gate g = strashFind(x, y);
+        if (g != gate_Undef)
+            return mkSig(g);
+
+        sh = &shards[strashHash(x, y) >> (sizeof(GateWord)*8 - 8)];
+        pthread_mutex_lock(&sh->lock);
+        g = strashLookup(sh->tab, sh->cap, x, y);
+        if (g != gate_True){
+            pthread_mutex_unlock(&sh->lock);
+            return mkSig(g); }
+    }
+
+    // New node needs to be created:
+    GateWord id = __sync_fetch_and_add(&conc_next, 1);
+    if (id >= conc_lim){
+        // Out of preallocated ids (the counter is clamped again in 'endConcurrent()'):
+        conc_full = true;
+        if (sh != NULL)
+            pthread_mutex_unlock(&sh->lock);
+        return sig_Undef;
+    }
+
+    Gate g = mkGate(id, gtype_And);
+    gate_x[g] = x;
+    gate_y[g] = y;
+    __sync_fetch_and_or (&and_bits[id >> 5], 1U << (id & 31));
+    __sync_fetch_and_add(&n_fanouts[gate(x)], 1);
+    __sync_fetch_and_add(&n_fanouts[gate(y)], 1);
+
+    if (sh != NULL){
+        if (++sh->n > sh->cap / 2){
+            // Grow this shard (it is private to the lock holder):
+            StrashCell* old_tab = sh->tab;
+            GateWord    old_cap = sh->cap;
+            sh->cap *= 2;
+            sh->tab  = (StrashCell*)zalloc(sh->cap, sizeof(StrashCell));
+            for (GateWord i = 0; i < old_cap; i++)
+                if (old_tab[i].g != gate_True)
+                    strashPut(sh->tab, sh->cap, old_tab[i].h, old_tab[i].g);
+            free(old_tab);
+        }
+        strashPut(sh->tab, sh->cap, strashHash(x, y), g);
+        pthread_mutex_unlock(&sh->lock);
+    }
+
+    return mkSig(g);
 }
 
 
@@ -180,12 +642,12 @@ void Circ::dump()
 {
     for (Gate g = firstGate(); g != gate_Undef; g = nextGate(g)){
         if (type(g) == gtype_And){
-            Sig x = gates[g].x;
-            Sig y = gates[g].y;
+            Sig x = gate_x[g];
+            Sig y = gate_y[g];
         
-            printf("gate %d := %s%d & %s%d\n", index(g), sign(x)?"-":"", index(gate(x)), sign(y)?"-":"", index(gate(y)));
+            printf("gate %"PRIgw" := %s%"PRIgw" & %s%"PRIgw"\n", index(g), sign(x)?"-":"", index(gate(x)), sign(y)?"-":"", index(gate(y)));
         }else{
-           printf("gate %d := <input>\n", index(g));
+           printf("gate %"PRIgw" := <input>\n", index(g));
         }
     }   
 }
@@ -21,6 +21,7 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #define Minisat_Circ_h
 
 #include <stdio.h>
+#include <pthread.h>
 
 #include "minisat/mtl/Queue.h"
 #include "minisat/core/SolverTypes.h"
@@ -33,39 +34,79 @@ namespace Minisat {
 // Circ -- a class for representing combinational circuits.
 
 
-static const uint32_t pair_hash_prime = 1073741789;
+// Number of cells of an old strash table that are migrated to the new table for every inserted
+// gate. Must be at least 2 to finish before the new table needs to grow again:
+static const unsigned int strash_migrate_rate = 4;
+
+// Number of separately locked strash tables used during concurrent construction:
+static const unsigned int strash_shards       = 256;
 
 class Circ
 {
     // Types:
-    struct GateData { Gate strash_next; Sig x, y; };
-    typedef GMap<GateData> Gates;
+    struct StrashCell { Gate g; GateWord h; }; // Free cells have 'g == gate_True' (zero-initialized).
+                                               // 'h' is the full hash of the children of 'g'.
+    struct FanoutLink { Gate g; uint32_t next; };
+
+    enum { link_Undef = UINT32_MAX };
 
     // Member variables:
     //
-    Gates               gates;        // Gates[0] is reserved for the constant gate_True.
-    GMap<uint8_t>       n_fanouts;
-
-    unsigned int        n_inps;
-    unsigned int        n_ands;
-    Gate*               strash;
-    unsigned int        strash_cap;
-    vec<uint32_t>       gate_lim;
-
-    Gate                tmp_gate;
+    GMap<Sig>           gate_x;       // }- Children of and-gates. For inputs 'gate_x' is 'sig_Undef' and
+    GMap<Sig>           gate_y;       // }  'gate_y' holds the number. Index 0 is reserved for gate_True.
+    vec<uint32_t>       and_bits;     // Bit 'i' is set iff the gate with index 'i' is an and-gate.
+    vec<Gate>           inps;         // All inputs in index order (which is also the order of creation,
+                                      // until 'reorder()').
+    GMap<uint32_t>      n_fanouts;
+
+    GateWord            n_ands;
+    StrashCell*         strash;       // Open-addressing (linear probing) table of and-gates.
+    GateWord            strash_cap;   // Always a power of two.
+    StrashCell*         strash_old;   // Previous table, while being migrated to 'strash' (or NULL).
+    GateWord            strash_old_cap;
+    GateWord            strash_moved; // Number of cells in 'strash_old' migrated so far.
+    vec<GateWord>       gate_lim;
+
+    // Fanout index (only maintained when 'has_fanouts' is set):
+    bool                has_fanouts;
+    GateWord            fanout_built; // Gates with smaller index have their fanouts in 'fanout_edges'.
+    GMap<GateSize>      fanout_begin; // }- Range of fanouts of each gate in 'fanout_edges' (CSR).
+    GMap<GateSize>      fanout_end;   // }
+    vec<Gate, GateSize> fanout_edges;
+    GMap<uint32_t>      fanout_head;  // First fanout added after the index was built ('link_Undef' if
+    vec<FanoutLink>     fanout_links; // none). Links are added and removed in stack order.
+
+    // Concurrent construction (see 'beginConcurrent()'):
+    struct StrashShard { pthread_mutex_t lock; StrashCell* tab; GateWord cap, n; };
+    StrashShard*        shards;       // Tables of gates created concurrently (or NULL).
+    volatile GateWord   conc_next;    // Next free gate id.
+    GateWord            conc_lim;     // Upper limit of gate ids.
+    volatile bool       conc_full;    // Some gate could not be created within 'conc_lim'.
+    bool                conc_fanouts; // Rebuild the fanout index afterwards.
 
     // Private methods:
     //
-    unsigned int allocId     ();
-    GateType     idType      (unsigned int id) const;
-    uint32_t     gateHash    (Gate g)          const;
-    bool         gateEq      (Gate x, Gate y)  const;
-    void         strashInsert(Gate g);
-    Gate         strashFind  (Gate g)          const;
-    void         strashRemove(Gate g);
-    void         restrashAll ();
-
-    Gate         gateFromId  (unsigned int id) const;
+    GateWord     allocId     (GateType t);
+    GateType     idType      (GateWord id) const;
+
+    static GateWord strashHash  (Sig x, Sig y);
+    Gate            strashLookup(const StrashCell* tab, GateWord cap, Sig x, Sig y) const;
+    static void     strashPut   (StrashCell* tab, GateWord cap, GateWord h, Gate g);
+    void            strashInsert(Gate g);
+    Gate            strashFind  (Sig x, Sig y)    const;
+    void            strashRemove(Gate g);
+    void            strashGrow  ();
+    void            strashMigrate(GateWord n_cells);
+    void            strashAlloc (GateWord n);
+    void            restrashAll (GateWord n_min = 0);
+    void            reserveGates(GateWord n_gates);
+
+    void            fanoutAdd   (Gate from, Gate to);
+    void            fanoutRemove(Gate g);
+
+    Gate         gateFromId  (GateWord id) const;
+    Sig          rewriteAnd  (Sig& x, Sig& y) const;
+    Sig          mkAndNode   (Sig x, Sig y);
 
  public:
     // Mode of operation:
@@ -77,27 +118,46 @@ class Circ
 
     // Misc. :
     //
-    int  size  () const { return gates.size()-1; }
-    int  nGates() const { return n_ands; }
-    int  nInps () const { return n_inps; }
-    int  nFanouts  (Gate g) const { return n_fanouts[g]; }
+    GateSize size  () const { return gate_x.size()-1; }
+    GateSize nGates() const { return n_ands; }
+    int      nInps () const { return inps.size(); }
+    int  nFanouts  (Gate g) const { return n_fanouts[g]; } // Fanout gates plus calls to 'bumpFanout()'.
     void bumpFanout(Gate g) { n_fanouts[g]++; }
 
     // Environment state manipulation:
     //
     void clear  ();
     void moveTo (Circ& to);
+    void reserve(GateWord n_gates);     // Pre-size for a circuit with 'n_gates' gates in total.
 
     void push   ();
     void pop    ();
     void commit ();
 
+    // Remove all and-gates not reachable from 'roots' (inputs are always kept), and renumber the
+    // remaining gates in place without changing their relative order. The old-to-new mapping is
+    // stored in 'remap' ('sig_Undef' for removed gates), suitable for use with 'map()':
+    void compact(const vec<Sig>& roots, GMap<Sig>& remap);
+
+    // Renumber all gates in depth-first post-order from 'roots' (followed by any gates they do not
+    // reach), so that gates are stored close to their children. The inputs are still iterated in
+    // index order afterwards, which is no longer their order of creation. The old-to-new mapping is
+    // stored in 'remap':
+    void reorder(const vec<Sig>& roots, GMap<Sig>& remap);
+
     // Gate iterator:
  private:
-    Gate nextGate (Gate g) const { assert(g != gate_Undef); uint32_t ind = index(g) + 1; return ind == (uint32_t)gates.size() ? gate_Undef : gateFromId(ind); }
+    Gate nextGate (Gate g) const { assert(g != gate_Undef); GateWord ind = index(g) + 1; return ind == (GateWord)gate_x.size() ? gate_Undef : gateFromId(ind); }
     Gate firstGate()       const { return nextGate(gateFromId(0)); }
+    int  firstInp (Gate g) const {    // Position in 'inps' of the first input not before 'g'.
+        int lo = 0, hi = inps.size();
+        while (lo < hi){
+            int mid = (lo + hi) / 2;
+            if (inps[mid] < g) lo = mid + 1;
+            else               hi = mid; }
+        return lo; }
  public:
-    Gate lastGate ()       const { return gateFromId(gates.size()-1); }
+    Gate lastGate ()       const { return gateFromId(gate_x.size()-1); }
 
     class GateIt {
     protected:
@@ -113,15 +173,15 @@ class Circ
         bool   operator!=(const GateIt& gi) const { assert(&c == &gi.c); return g != gi.g; }
     };
 
+    // Iterates over the inputs in index order, starting from the first input not before '_g' (the
+    // input list is walked, so no other gates are visited):
     class InpIt : public GateIt {
     protected:
-        void nextInput(){
-            while (g != gate_Undef && type(g) != gtype_Inp)
-                g = c.nextGate(g);
-        }
+        int  i;                       // Position of 'g' in 'c.inps'.
+        void nextInput(){ g = i < c.inps.size() ? c.inps[i] : gate_Undef; }
     public:
-        InpIt(const Circ& _c, Gate _g) : GateIt(_c,_g) { nextInput(); }
-        InpIt operator++() { g = c.nextGate(g); nextInput(); return *this; }
+        InpIt(const Circ& _c, Gate _g) : GateIt(_c,_g), i(_c.firstInp(_g)) { nextInput(); }
+        InpIt operator++() { i++; nextInput(); return *this; }
     };
 
     GateIt begin0  () const { return GateIt(*this, gateFromId(0)); }
@@ -131,9 +191,44 @@ class Circ
     InpIt  inpBegin() const { return InpIt(*this, gateFromId(0)); }
     InpIt  inpEnd  () const { return InpIt(*this, gate_Undef); }
 
+    // Fanout index. Once built, it is kept up to date by 'mkAnd()' and 'pop()' until cleared:
+    //
+    void buildFanouts();
+    void clearFanouts();
+    bool hasFanouts  () const { return has_fanouts; }
+
+    class FanoutIt {
+        const Circ& c;
+        GateSize    i, end;           // Position in 'fanout_edges', followed by ...
+        uint32_t    link;             // ... the chain of 'fanout_links'.
+    public:
+        FanoutIt(const Circ& _c, GateSize _i, GateSize _end, uint32_t _link) : c(_c), i(_i), end(_end), link(_link){}
+
+        Gate     operator* () const { return i < end ? c.fanout_edges[i] : c.fanout_links[link].g; }
+        FanoutIt operator++()       { if (i < end) i++; else link = c.fanout_links[link].next; return *this; }
+
+        bool     operator==(const FanoutIt& fi) const { assert(&c == &fi.c); return i == fi.i && link == fi.link; }
+        bool     operator!=(const FanoutIt& fi) const { assert(&c == &fi.c); return i != fi.i || link != fi.link; }
+    };
+
+    FanoutIt fanoutBegin(Gate g) const { assert(has_fanouts); return FanoutIt(*this, fanout_begin[g], fanout_end[g], fanout_head[g]); }
+    FanoutIt fanoutEnd  (Gate g) const { assert(has_fanouts); return FanoutIt(*this, fanout_end[g], fanout_end[g], link_Undef); }
+
+    // Concurrent construction. Between 'beginConcurrent(n)' and 'endConcurrent()' the method
+    // 'mkAndConcurrent()' may be called from several threads at the same time, creating at most 'n'
+    // new gates. Structurally equal gates are still only created once. Nothing else that modifies
+    // the circuit may be used in this mode, and the gates created are not visible to 'lookupAnd()'
+    // until 'endConcurrent()'. When the limit is reached 'mkAndConcurrent()' returns 'sig_Undef'
+    // (as it does for 'sig_Undef' arguments), and 'endConcurrent()' returns false.
+    //
+    void beginConcurrent(GateWord n_max);
+    bool endConcurrent  ();
+    bool isConcurrent   () const { return shards != NULL; }
+    Sig  mkAndConcurrent(Sig x, Sig y);
+
     // Node constructor functions:
     Sig mkInp    (uint32_t num = UINT32_MAX);
-    Sig mkAnd    (Sig x, Sig y, bool try_only = false);
+    Sig mkAnd    (Sig x, Sig y);
     Sig mkOr     (Sig x, Sig y);
     Sig mkXorOdd (Sig x, Sig y);
     Sig mkXorEven(Sig x, Sig y);
@@ -142,9 +237,13 @@ class Circ
     Sig mkMuxEven(Sig x, Sig y, Sig z);
     Sig mkMux    (Sig x, Sig y, Sig z);
 
+    // Create 'out[i] = xs[i] & ys[i]' for many independent pairs in one call (faster than calling
+    // 'mkAnd()' for each pair):
+    void mkAnds  (const vec<Sig>& xs, const vec<Sig>& ys, vec<Sig>& out);
+
     // Input numbering:
-    const uint32_t& number(Gate g) const { assert(type(g) == gtype_Inp); return gates[g].y.x; }
-    uint32_t&       number(Gate g)       { assert(type(g) == gtype_Inp); return gates[g].y.x; }
+    const GateWord& number(Gate g) const { assert(type(g) == gtype_Inp); return gate_y[g].x; }
+    GateWord&       number(Gate g)       { assert(type(g) == gtype_Inp); return gate_y[g].x; }
 
     // Node inspection functions:
     Sig lchild(Gate g) const;
@@ -153,12 +252,15 @@ class Circ
     Sig rchild(Sig x)  const;
 
     // Lookup whether different different patterns already exists somewhere:
-    Sig tryAnd     (Sig x, Sig y);
-    int costAnd    (Sig x, Sig y);
-    int costXorOdd (Sig x, Sig y);
-    int costXorEven(Sig x, Sig y);
-    int costMuxOdd (Sig x, Sig y, Sig z);
-    int costMuxEven(Sig x, Sig y, Sig z);
+    // NOTE: these never modify the circuit, and may be called from several threads at the same time
+    // as long as no thread modifies it.
+    Sig lookupAnd  (Sig x, Sig y)        const;
+    Sig tryAnd     (Sig x, Sig y)        const; // Same as 'lookupAnd()'.
+    int costAnd    (Sig x, Sig y)        const;
+    int costXorOdd (Sig x, Sig y)        const;
+    int costXorEven(Sig x, Sig y)        const;
+    int costMuxOdd (Sig x, Sig y, Sig z) const;
+    int costMuxEven(Sig x, Sig y, Sig z) const;
 
     // Debug
     void dump();
@@ -337,87 +439,147 @@ void map(const GMap<Sig>& m, GMap<Sig>& tm){
 //=================================================================================================
 // Implementation of inline methods:
 
-inline unsigned int Circ::allocId()
+inline GateWord Circ::allocId(GateType t)
 {
-    uint32_t id = gates.size();
-    Gate     g  = mkGate(id, /* doesn't matter which type */ gtype_Inp);
-    gates.growTo(g);
+    GateWord id = gate_x.size();
+    Gate     g  = mkGate(id, t);
+    gate_x.growTo(g);
+    gate_y.growTo(g);
     n_fanouts.growTo(g, 0);
-    assert((uint32_t)gates.size() == id + 1);
+    and_bits.growTo((id >> 5) + 1, 0);
+    if (t == gtype_And)
+        and_bits[id >> 5] |=  (1U << (id & 31));
+    else
+        and_bits[id >> 5] &= ~(1U << (id & 31));
+    if (has_fanouts){
+        fanout_begin.growTo(g, 0);
+        fanout_end  .growTo(g, 0);
+        fanout_head .growTo(g, link_Undef);
+    }
+    assert((GateWord)gate_x.size() == id + 1);
     return id;
 }
 
 
-inline GateType Circ::idType(unsigned int id) const { 
-    return id == 0 ? gtype_Const : gates[mkGate(id, gtype_And)].x == sig_Undef ? gtype_Inp : gtype_And; }
-inline Gate     Circ::gateFromId(unsigned int id) const { return mkGate(id, idType(id)); }
+inline GateType Circ::idType(GateWord id) const { 
+    return id == 0 ? gtype_Const : GateType((and_bits[id >> 5] >> (id & 31)) & 1); }
+inline Gate     Circ::gateFromId(GateWord id) const { return mkGate(id, idType(id)); }
 
 //=================================================================================================
 // Implementation of strash-functions:
 
-inline uint32_t Circ::gateHash(Gate g) const
+// Hash a (normalized) pair of children. The hash is the high bits of a multiplicative hash of the
+// packed 64-bit key, which is well spread for power-of-two sizes. A table is indexed by its low
+// bits, and the full hash is kept in the cell, so that the children of a gate only need to be
+// read when the hashes match (and never when cells are moved):
+inline GateWord Circ::strashHash(Sig x, Sig y)
 {
-    assert(type(g) == gtype_And);
-    return index(gates[g].x) * pair_hash_prime + index(gates[g].y); 
+#ifdef MCL_WIDE_GATES
+    uint64_t h = ((x.x * 0xC2B2AE3D27D4EB4FULL) ^ y.x) * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 32);
+#else
+    uint64_t key = ((uint64_t)x.x << 32) | (uint64_t)y.x;
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32);
+#endif
 }
 
 
-inline bool Circ::gateEq(Gate x, Gate y) const
+inline Gate Circ::strashLookup(const StrashCell* tab, GateWord cap, Sig x, Sig y) const
 {
-    assert(x != gate_Undef);
-    assert(y != gate_Undef);
-    assert(type(x) == gtype_And);
-    assert(type(y) == gtype_And);
-    //printf("checking %d : %c%d, %c%d\n", index(x), sign(gs[x].x)?' ':'-', index(gate(gs[x].x)), sign(gs[x].y)?' ':'-', index(gate(gs[x].y)));
-    //printf("    ---- %d : %c%d, %c%d\n", index(y), sign(gs[y].x)?' ':'-', index(gate(gs[y].x)), sign(gs[y].y)?' ':'-', index(gate(gs[y].y)));
-    return gates[x].x == gates[y].x && gates[x].y == gates[y].y;
+    GateWord h = strashHash(x, y);
+    for (GateWord i = h & (cap - 1);; i = (i + 1) & (cap - 1)){
+        const StrashCell& c = tab[i];
+        if (c.g == gate_True || (c.h == h && gate_x[c.g] == x && gate_y[c.g] == y))
+            return c.g;
+    }
 }
 
 
-inline Gate Circ::strashFind  (Gate g) const
+inline void Circ::strashPut(StrashCell* tab, GateWord cap, GateWord h, Gate g)
 {
-    assert(type(g) == gtype_And);
-    Gate h;
-    //printf("searching for gate:\n");
-    for (h = strash[gateHash(g) % strash_cap]; h != gate_Undef && !gateEq(h, g); h = gates[h].strash_next)
-        //printf(" --- inspecting gate: %d\n", index(h));
+    GateWord i;
+    for (i = h & (cap - 1); tab[i].g != gate_True; i = (i + 1) & (cap - 1))
         ;
-    return h;
+    tab[i].g = g;
+    tab[i].h = h;
 }
 
 
-inline void Circ::strashRemove(Gate g)
+// Move up to 'n_cells' cells of the old table (if any) into the current table:
+inline void Circ::strashMigrate(GateWord n_cells)
 {
-    Gate* h;
-    // printf("searching for gate %d to delete:\n", index(g));
-    for (h = &strash[gateHash(g) % strash_cap]; !gateEq(*h, g); h = &gates[*h].strash_next)
-        // printf(" --- inspecting gate: %d\n", index(*h));
-        ;
-    assert(*h != gate_Undef);
-    assert(gateEq(*h, g));
+    for (; n_cells > 0 && strash_moved < strash_old_cap; n_cells--, strash_moved++){
+        const StrashCell& c = strash_old[strash_moved];
+        if (c.g != gate_True)
+            strashPut(strash, strash_cap, c.h, c.g);
+    }
 
-    *h = gates[*h].strash_next;
+    if (strash_old != NULL && strash_moved == strash_old_cap){
+        free(strash_old);
+        strash_old     = NULL;
+        strash_old_cap = 0;
+        strash_moved   = 0;
+    }
+}
+
+
+// NOTE: while a migration is in progress the old table is left untouched, so cells that have not
+// been moved yet are still found there.
+inline Gate Circ::strashFind(Sig x, Sig y) const
+{
+    Gate g = strashLookup(strash, strash_cap, x, y);
+    if (g == gate_True && strash_old != NULL)
+        g = strashLookup(strash_old, strash_old_cap, x, y);
+    return g == gate_True ? gate_Undef : g;
+}
+
+
+inline void Circ::strashRemove(Gate g)
+{
+    // Removing from the old table could move cells that are not yet migrated, so finish first:
+    strashMigrate(strash_old_cap);
+
+    GateWord mask = strash_cap - 1;
+    GateWord i    = strashHash(gate_x[g], gate_y[g]) & mask;
+    while (strash[i].g != g){
+        assert(strash[i].g != gate_True);
+        i = (i + 1) & mask; }
+
+    // Shift back entries in the same probe sequence to fill the hole at 'i':
+    for (GateWord j = (i + 1) & mask; strash[j].g != gate_True; j = (j + 1) & mask){
+        GateWord h = strash[j].h & mask;
+        if (((j - h) & mask) >= ((j - i) & mask)){
+            strash[i] = strash[j];
+            i = j;
+        }
+    }
+    strash[i].g = gate_True;
 }
 
 
 inline void Circ::strashInsert(Gate g)
 {
     assert(type(g) == gtype_And);
-    assert(g != tmp_gate);
-    assert(strashFind(g) == gate_Undef);
-    uint32_t pos = gateHash(g) % strash_cap;
-    assert(strash[pos] != g);
-    gates[g].strash_next = strash[pos];
-    strash[pos] = g;
+    assert(strashFind(gate_x[g], gate_y[g]) == gate_Undef);
+    strashPut(strash, strash_cap, strashHash(gate_x[g], gate_y[g]), g);
+    strashMigrate(strash_migrate_rate);
 }
 
 
 
 
-inline Sig  Circ::lchild(Gate g) const   { assert(type(g) == gtype_And && g != gate_True && g != gate_Undef); return gates[g].x; }
-inline Sig  Circ::rchild(Gate g) const   { assert(type(g) == gtype_And && g != gate_True && g != gate_Undef); return gates[g].y; }
-inline Sig  Circ::lchild(Sig  x) const   { assert(type(x) == gtype_And && gate(x) != gate_True && x != sig_Undef); return gates[gate(x)].x; }
-inline Sig  Circ::rchild(Sig  x) const   { assert(type(x) == gtype_And && gate(x) != gate_True && x != sig_Undef); return gates[gate(x)].y; }
+inline void Circ::fanoutAdd(Gate from, Gate to)
+{
+    FanoutLink l = { to, fanout_head[from] };
+    fanout_head[from] = fanout_links.size();
+    fanout_links.push(l);
+}
+
+
+inline Sig  Circ::lchild(Gate g) const   { assert(type(g) == gtype_And && g != gate_True && g != gate_Undef); return gate_x[g]; }
+inline Sig  Circ::rchild(Gate g) const   { assert(type(g) == gtype_And && g != gate_True && g != gate_Undef); return gate_y[g]; }
+inline Sig  Circ::lchild(Sig  x) const   { assert(type(x) == gtype_And && gate(x) != gate_True && x != sig_Undef); return gate_x[gate(x)]; }
+inline Sig  Circ::rchild(Sig  x) const   { assert(type(x) == gtype_And && gate(x) != gate_True && x != sig_Undef); return gate_y[gate(x)]; }
 inline Sig  Circ::mkOr     (Sig x, Sig y){ return ~mkAnd(~x, ~y); }
 inline Sig  Circ::mkXorOdd (Sig x, Sig y){ return mkOr (mkAnd(x, ~y), mkAnd(~x, y)); }
 inline Sig  Circ::mkXorEven(Sig x, Sig y){ return mkAnd(mkOr(~x, ~y), mkOr ( x, y)); }
@@ -426,13 +588,16 @@ inline Sig  Circ::mkMuxOdd (Sig x, Sig y, Sig z) { return mkOr (mkAnd( x, y), mk
 inline Sig  Circ::mkMuxEven(Sig x, Sig y, Sig z) { return mkAnd(mkOr (~x, y), mkOr ( x, z)); }
 inline Sig  Circ::mkMux    (Sig x, Sig y, Sig z) { return mkMuxEven(x, y, z); }
 inline Sig  Circ::mkInp    (uint32_t num){ 
-    n_inps++; 
-    Gate g = mkGate(allocId(), gtype_Inp); 
-    gates[g].x   = sig_Undef; 
-    gates[g].y.x = num;
+    Gate g = mkGate(allocId(gtype_Inp), gtype_Inp); 
+    gate_x[g]   = sig_Undef; 
+    gate_y[g].x = num;
+    inps.push(g);
     return mkSig(g, false); }
 
-inline Sig  Circ::mkAnd    (Sig x, Sig y, bool try_only){
+// Apply the rewrite rules to 'x & y'. If the result is an already existing signal it is returned,
+// otherwise 'sig_Undef' is returned and 'x', 'y' are set to the (ordered) children of the and-gate
+// that represents the result:
+inline Sig  Circ::rewriteAnd(Sig& x, Sig& y) const {
     assert(x != sig_Undef);
     assert(y != sig_Undef);
 
@@ -520,7 +685,6 @@ inline Sig  Circ::mkAnd    (Sig x, Sig y, bool try_only){
         
     }
 
-    Gate g = gate_Undef;
     if (rewrite_mode >= 1){
         assert(x != y);
         assert(x != ~y);
@@ -531,36 +695,51 @@ inline Sig  Circ::mkAnd    (Sig x, Sig y, bool try_only){
 
         // Order:
         if (y < x) { Sig tmp = x; x = y; y = tmp; }
+    }
 
-        // Strash-lookup:
-        g = mkGate(index(tmp_gate), gtype_And);
-        gates[g].x = x;
-        gates[g].y = y;
+    return sig_Undef;
+}
 
-        // fprintf(stderr, "looking up node: %c%d & %c%d\n", sign(x)?'~':' ', index(gate(x)), sign(y)?'~':' ', index(gate(y)));
-        
-        g = strashFind(g);
-    }
 
-    if (!try_only && g == gate_Undef){
+inline Sig  Circ::lookupAnd(Sig x, Sig y) const
+{
+    Sig z = rewriteAnd(x, y);
+    if (z != sig_Undef)
+        return z;
+
+    // Strash-lookup:
+    // fprintf(stderr, "looking up node: %c%d & %c%d\n", sign(x)?'~':' ', index(gate(x)), sign(y)?'~':' ', index(gate(y)));
+    return rewrite_mode >= 1 ? mkSig(strashFind(x, y)) : sig_Undef;
+}
+
+
+inline Sig  Circ::mkAnd    (Sig x, Sig y){
+    Sig z = rewriteAnd(x, y);
+    return z != sig_Undef ? z : mkAndNode(x, y);
+}
+
+// Find or create the and-gate with children 'x' and 'y', which must be the result of 'rewriteAnd()':
+inline Sig  Circ::mkAndNode(Sig x, Sig y){
+    Gate g = rewrite_mode >= 1 ? strashFind(x, y) : gate_Undef;
+
+    if (g == gate_Undef){
         // New node needs to be created:
-        g = mkGate(allocId(), gtype_And);
-        gates[g].x = x;
-        gates[g].y = y;
+        g = mkGate(allocId(gtype_And), gtype_And);
+        gate_x[g] = x;
+        gate_y[g] = y;
         n_ands++;
         
         // Insert into strash map:
         if (n_ands > strash_cap / 2)
-            restrashAll();
-        else
-            strashInsert(g);
+            strashGrow();
+        strashInsert(g);
 
         // Update fanout counters:
-        if (n_fanouts[gate(x)] < 255) n_fanouts[gate(x)]++;
-        if (n_fanouts[gate(y)] < 255) n_fanouts[gate(y)]++;
-
-        // if (n_fanouts[gate(x)] == 255) printf("High fanout detected!\n");
-        // if (n_fanouts[gate(y)] == 255) printf("High fanout detected!\n");
+        n_fanouts[gate(x)]++;
+        n_fanouts[gate(y)]++;
+        if (has_fanouts){
+            fanoutAdd(gate(x), g);
+            fanoutAdd(gate(y), g); }
 
         // fprintf(stderr, "created node %3d = %c%d & %c%d\n", index(g), sign(x)?'~':' ', index(gate(x)), sign(y)?'~':' ', index(gate(y)));
         //printf(" -- created new node.\n");
@@ -571,41 +750,23 @@ inline Sig  Circ::mkAnd    (Sig x, Sig y, bool try_only){
     return mkSig(g);
 }
 
-#if 0
-inline Sig Circ::tryAnd(Sig x, Sig y)
-{
-    assert(gate(x) != gate_True);
-    assert(gate(y) != gate_True);
-
-    // Order:
-    if (y < x) { Sig tmp = x; x = y; y = tmp; }
+inline Sig Circ::tryAnd(Sig x, Sig y) const { return lookupAnd(x, y); }
 
-    // Strash-lookup:
-    Gate g = mkGate(index(tmp_gate), gtype_And);
-    gates[g].x = x;
-    gates[g].y = y;
-
-    return mkSig(strashFind(g));
-}
-#else
-inline Sig Circ::tryAnd(Sig x, Sig y) { return mkAnd(x, y, true); }
-#endif
-
-inline int Circ::costAnd (Sig x, Sig y)
+inline int Circ::costAnd (Sig x, Sig y) const
 {
-    return tryAnd(x, y) == sig_Undef ? 1 : 0;
+    return lookupAnd(x, y) == sig_Undef ? 1 : 0;
 }
 
 #if 1
-inline int Circ::costMuxOdd (Sig x, Sig y, Sig z)
+inline int Circ::costMuxOdd (Sig x, Sig y, Sig z) const
 {
     // return mkOr (mkAnd( x, y), mkAnd(~x, z));
-    Sig a = tryAnd( x, y);
-    Sig b = tryAnd(~x, z);
+    Sig a = lookupAnd( x, y);
+    Sig b = lookupAnd(~x, z);
     Sig c = sig_Undef;
 
     if (a != sig_Undef && b != sig_Undef)
-        c = tryAnd(~a, ~b);
+        c = lookupAnd(~a, ~b);
 
     return (int)(a == sig_Undef) + (int)(b == sig_Undef) + (int)(c == sig_Undef);
 }
@@ -622,16 +783,16 @@ inline int Circ::costMuxOdd (Sig x, Sig y, Sig z)
 #endif
 
 #if 1
-inline int Circ::costMuxEven(Sig x, Sig y, Sig z)
+inline int Circ::costMuxEven(Sig x, Sig y, Sig z) const
 {
     // return mkAnd(mkOr (~x, y), mkOr ( x, z));
 
-    Sig a = tryAnd( x, ~y);
-    Sig b = tryAnd(~x, ~z);
+    Sig a = lookupAnd( x, ~y);
+    Sig b = lookupAnd(~x, ~z);
     Sig c = sig_Undef;
 
     if (a != sig_Undef && b != sig_Undef)
-        c = tryAnd(~a, ~b);
+        c = lookupAnd(~a, ~b);
 
     return (int)(a == sig_Undef) + (int)(b == sig_Undef) + (int)(c == sig_Undef);
 }
@@ -647,8 +808,8 @@ inline int Circ::costMuxEven(Sig x, Sig y, Sig z)
 }
 #endif
 
-inline int Circ::costXorOdd (Sig x, Sig y){ return costMuxOdd (x, ~y, y); }
-inline int Circ::costXorEven(Sig x, Sig y){ return costMuxEven(x, ~y, y); }
+inline int Circ::costXorOdd (Sig x, Sig y) const { return costMuxOdd (x, ~y, y); }
+inline int Circ::costXorEven(Sig x, Sig y) const { return costMuxEven(x, ~y, y); }
 
 
 //=================================================================================================
@@ -262,7 +262,7 @@ void Minisat::printSig(Sig x)
     else if (x == sig_False)
         printf("0");
     else
-        printf("%s%c%d", sign(x)?"-":"", type(x)==gtype_Inp?'i':'a', index(gate(x)));
+        printf("%s%c%"PRIgw, sign(x)?"-":"", type(x)==gtype_Inp?'i':'a', index(gate(x)));
 }
 
 void Minisat::printGate(Gate g){ printSig(mkSig(g)); }
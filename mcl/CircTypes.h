@@ -20,11 +20,32 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef Minisat_CircTypes_h
 #define Minisat_CircTypes_h
 
+#include <string.h>
+
 #include "minisat/mtl/IntTypes.h"
 #include "minisat/mtl/Vec.h"
 
 namespace Minisat {
 
+//=================================================================================================
+// Word size:
+//
+//   Gates and signals are packed into 32-bit words by default, which limits a circuit to 2^30 gates.
+//   Compiling everything with 'MCL_WIDE_GATES' defined packs them into 64-bit words instead, and
+//   gives 'GMap'/'SMap' 64-bit sizes.
+
+#ifdef MCL_WIDE_GATES
+typedef uint64_t GateWord;  // Representation of 'Gate' and 'Sig', and type of gate indices.
+typedef int64_t  GateSize;  // Size type of 'GMap' and 'SMap'.
+#define PRIgw    PRIu64     // }- printf-formats for the above.
+#define PRIgs    PRId64     // }
+#else
+typedef uint32_t GateWord;
+typedef int      GateSize;
+#define PRIgw    PRIu32
+#define PRIgs    "d"
+#endif
+
 //=================================================================================================
 // Helper types (analogues of Var/Lit types from MiniSat):
 
@@ -34,9 +55,9 @@ typedef enum { gtype_Inp = 0, gtype_And = 1, gtype_Const = 2 } GateType;
 // Gate-type: (analogue of MiniSat's Var)
 
 
-// --- bit 0: type { 0 = inp, 1 = and }, 1 : unused, 2-31 data ---
+// --- bit 0: type { 0 = inp, 1 = and }, 1 : unused, 2-31 (or 2-63) data ---
 struct Gate {
-    unsigned int x;
+    GateWord x;
     bool operator == (Gate p) const { return x == p.x; }
     bool operator != (Gate p) const { return x != p.x; }
     bool operator <  (Gate p) const { return x <  p.x; }
@@ -45,23 +66,23 @@ struct Gate {
     bool operator >= (Gate p) const { return x >= p.x; }
 };
 
-const Gate gate_Undef = { ((1U << 30)-1) << 2 };
+const Gate gate_Undef = { ((GateWord(1) << (sizeof(GateWord)*8 - 2))-1) << 2 };
 const Gate gate_True  = { 0 };
 
 // Use this as a constructor:
-inline Gate         mkGate  (unsigned int id, GateType t){
-    Gate g; g.x = (id << 2) + (unsigned int)(t == gtype_And); return g; }
+inline Gate         mkGate  (GateWord id, GateType t){
+    Gate g; g.x = (id << 2) + (GateWord)(t == gtype_And); return g; }
 inline GateType     type    (Gate g){ return g == gate_True ? gtype_Const : GateType(g.x & 1); }
 
 // Note! Use GMap instead of this:
-inline unsigned int index (Gate g) { return g.x >> 2; }
+inline GateWord index (Gate g) { return g.x >> 2; }
 
 //-------------------------------------------------------------------------------------------------
 // Signal-type: (analogue of MiniSat's Lit)
 
-// --- bit 0: type { 0 = inp, 1 = and }, 1 : sign, 2-31 data ---
+// --- bit 0: type { 0 = inp, 1 = and }, 1 : sign, 2-31 (or 2-63) data ---
 struct Sig {
-    unsigned int x;
+    GateWord x;
     bool operator == (Sig p) const { return x == p.x; }
     bool operator != (Sig p) const { return x != p.x; }
     bool operator <  (Sig p) const { return x <  p.x; } // '<' makes p, ~p adjacent in the ordering.
@@ -73,35 +94,56 @@ struct Sig {
 //const Sig lit_Undef = mkSig(var_Undef, false);  // }- Useful special constants.
 //const Sig lit_Error = mkSig(var_Undef, true );  // }
 
-const Sig sig_Undef = { ((1U << 30)-1) << 2 };  // }- Useful special constants.
-const Sig sig_Error = { (((1U << 30)-1) << 2) + 2};  // }
+const Sig sig_Undef = { gate_Undef.x     };  // }- Useful special constants.
+const Sig sig_Error = { gate_Undef.x + 2 };  // }
 const Sig sig_True  = { 0 };
 const Sig sig_False = { 2 };
 
 // Use this as a constructor:
 inline  Sig mkSig(Gate g, bool sign = false){ 
-    Sig p; p.x = g.x + (unsigned)sign + (unsigned)sign; return p; }
+    Sig p; p.x = g.x + (GateWord)sign + (GateWord)sign; return p; }
 
 // TODO: make sure 'sig_Undef == ~sig_Undef' and 'sig_Error == ~sig_Error'?
 inline  Sig      operator ~(Sig p)                       { Sig q; q.x = p.x ^ 2; return q; }
-inline  Sig      operator ^(Sig p, bool b)               { Sig q; q.x = p.x ^ (((unsigned int)b)<<1); return q; }
+inline  Sig      operator ^(Sig p, bool b)               { Sig q; q.x = p.x ^ (((GateWord)b)<<1); return q; }
 inline  bool     sign      (Sig p)                       { return bool(p.x & 2); }
 inline  Gate     gate      (Sig p)                       { return mkGate(p.x >> 2, GateType(p.x & 1)); }
 inline  GateType type      (Sig p)                       { return type(gate(p)); }
 
 // Mapping Signals to and from compact integers suitable for array indexing:
-inline  Sig          toSig     (unsigned  i)         { Sig p; p.x = i; return p; } 
+inline  Sig          toSig     (GateWord  i)         { Sig p; p.x = i; return p; } 
 
 // Note! Use SMap instead of this:
-inline unsigned int index (Sig s) { return s.x >> 1; }
+inline GateWord index (Sig s) { return s.x >> 1; }
 
 
 //=================================================================================================
 // Map-types:
 
+#ifdef MCL_WIDE_GATES
+// Move the contents of 'from' into 'to' for the wide size type ('vec::moveTo()' only accepts
+// vectors with the default size type). This assumes that a 'vec' is trivially relocatable: it is
+// just a data pointer and two sizes (checked below), and holds no pointers into itself. Swapping
+// the raw bytes with the freed 'to' then leaves 'from' empty:
+template<class T, class S>
+inline void vecMoveTo(vec<T,S>& from, vec<T,S>& to)
+{
+    (void)sizeof(char[sizeof(vec<T,S>) == sizeof(T*) + 2 * sizeof(S) ? 1 : -1]);
+    if (&from == &to) return;
+    to.clear(true);
+    char tmp[sizeof(vec<T,S>)];
+    memcpy(tmp,         (void*)&to,   sizeof(tmp));
+    memcpy((void*)&to,  (void*)&from, sizeof(tmp));
+    memcpy((void*)&from, tmp,         sizeof(tmp));
+}
+#endif
+
+
 template<class T>
-class GMap : private vec<T>
+class GMap : private vec<T, GateSize>
 {
+    typedef vec<T, GateSize> Vec;
+
  public:
     // Create new GMap with zero capacity:
     GMap(){}                                      
@@ -111,31 +153,44 @@ class GMap : private vec<T>
 
     // FIXME: I think this works for empty vectors (gmaps), but I need to check.
     typedef T* iterator;
-    iterator begin  (){ return &vec<T>::operator[](0); }
-    iterator end    (){ return &vec<T>::operator[](vec<T>::size()); }
+    iterator begin  (){ return &Vec::operator[](0); }
+    iterator end    (){ return &Vec::operator[](Vec::size()); }
 
     // Vector interface:
-    const T& operator [] (Gate g)  const { assert(g != gate_Undef); assert(index(g) < (unsigned)vec<T>::size()); return vec<T>::operator[](index(g)); }
-    T&       operator [] (Gate g)        { assert(g != gate_Undef); assert(index(g) < (unsigned)vec<T>::size()); return vec<T>::operator[](index(g)); }
+    const T& operator [] (Gate g)  const { assert(g != gate_Undef); assert(index(g) < (GateWord)Vec::size()); return Vec::operator[](index(g)); }
+    T&       operator [] (Gate g)        { assert(g != gate_Undef); assert(index(g) < (GateWord)Vec::size()); return Vec::operator[](index(g)); }
 
     // Note the slightly different semantics to vec's growTo, namely that
     // this guarantees that the element 'g' can be indexed after this operation.
-    void     growTo (Gate g)             { vec<T>::growTo(index(g) + 1   ); }
-    void     growTo (Gate g, const T& e) { vec<T>::growTo(index(g) + 1, e); }
-    void     shrink (int size)           { vec<T>::shrink(size); }
-
-    bool     has    (Gate g)      const  { return index(g) < (unsigned)vec<T>::size(); }
-    void     clear  (bool free = false)  { vec<T>::clear(free); }
-    int      size   () const             { return vec<T>::size(); }
-
-    void     moveTo (GMap<T>& to)        { vec<T>::moveTo((vec<T>&)to); }
-    void     copyTo (GMap<T>& to) const  { vec<T>::copyTo((vec<T>&)to); }
+    void     growTo (Gate g)             { Vec::growTo(index(g) + 1   ); }
+    void     growTo (Gate g, const T& e) { Vec::growTo(index(g) + 1, e); }
+    void     shrink (GateSize size)      { Vec::shrink(size); }
+
+    // Reserve memory such that growing up to gate 'g' will not reallocate:
+    void     reserve(Gate g)             { Vec::capacity(index(g) + 1); }
+
+    bool     has    (Gate g)      const  { return index(g) < (GateWord)Vec::size(); }
+    void     clear  (bool free = false)  { Vec::clear(free); }
+    GateSize size   () const             { return Vec::size(); }
+
+#ifdef MCL_WIDE_GATES
+    // NOTE: vec's 'moveTo()' and 'copyTo()' only work with its default size type:
+    void     moveTo (GMap<T>& to)        { vecMoveTo((Vec&)*this, (Vec&)to); }
+    void     copyTo (GMap<T>& to) const  {
+        to.clear(); to.Vec::growTo(size());
+        for (GateSize i = 0; i < size(); i++) ((Vec&)to)[i] = Vec::operator[](i); }
+#else
+    void     moveTo (GMap<T>& to)        { Vec::moveTo((Vec&)to); }
+    void     copyTo (GMap<T>& to) const  { Vec::copyTo((Vec&)to); }
+#endif
 };
 
 
 template<class T>
-class SMap : private vec<T>
+class SMap : private vec<T, GateSize>
 {
+    typedef vec<T, GateSize> Vec;
+
  public:
     // Create new SMap with zero capacity:
     SMap(){}                                      
@@ -145,25 +200,33 @@ class SMap : private vec<T>
 
     // FIXME: I think this works for empty vectors (smaps), but I need to check.
     typedef T* iterator;
-    iterator begin  (){ return &vec<T>::operator[](0); }
-    iterator end    (){ return &vec<T>::operator[](vec<T>::size()); }
+    iterator begin  (){ return &Vec::operator[](0); }
+    iterator end    (){ return &Vec::operator[](Vec::size()); }
 
     // Vector interface:
-    const T& operator [] (Sig x) const   { assert(x != sig_Undef); assert(index(x) < (unsigned)vec<T>::size()); return vec<T>::operator[](index(x)); }
-    T&       operator [] (Sig x)         { assert(x != sig_Undef); assert(index(x) < (unsigned)vec<T>::size()); return vec<T>::operator[](index(x)); }
+    const T& operator [] (Sig x) const   { assert(x != sig_Undef); assert(index(x) < (GateWord)Vec::size()); return Vec::operator[](index(x)); }
+    T&       operator [] (Sig x)         { assert(x != sig_Undef); assert(index(x) < (GateWord)Vec::size()); return Vec::operator[](index(x)); }
 
     // Note the slightly different semantics to vec's capacity, namely that
     // this guarantees that the element 'g' can be indexed after this operation.
-    void     growTo (Sig x)              { vec<T>::growTo(index(x) + 1   ); }
-    void     growTo (Sig x, const T& e)  { vec<T>::growTo(index(x) + 1, e); }
-    void     shrink (int size)           { vec<T>::shrink(size); }
-
-    bool     has    (Sig x)       const  { return index(x) < (unsigned)vec<T>::size(); }
-    void     clear  (bool free = false)  { vec<T>::clear(free); }
-    int      size   () const             { return vec<T>::size(); }
-
-    void     moveTo (SMap<T>& to)        { vec<T>::moveTo((vec<T>&)to); }
-    void     copyTo (SMap<T>& to) const  { vec<T>::copyTo((vec<T>&)to); }
+    void     growTo (Sig x)              { Vec::growTo(index(x) + 1   ); }
+    void     growTo (Sig x, const T& e)  { Vec::growTo(index(x) + 1, e); }
+    void     shrink (GateSize size)      { Vec::shrink(size); }
+
+    bool     has    (Sig x)       const  { return index(x) < (GateWord)Vec::size(); }
+    void     clear  (bool free = false)  { Vec::clear(free); }
+    GateSize size   () const             { return Vec::size(); }
+
+#ifdef MCL_WIDE_GATES
+    // NOTE: vec's 'moveTo()' and 'copyTo()' only work with its default size type:
+    void     moveTo (SMap<T>& to)        { vecMoveTo((Vec&)*this, (Vec&)to); }
+    void     copyTo (SMap<T>& to) const  {
+        to.clear(); to.Vec::growTo(size());
+        for (GateSize i = 0; i < size(); i++) ((Vec&)to)[i] = Vec::operator[](i); }
+#else
+    void     moveTo (SMap<T>& to)        { Vec::moveTo((Vec&)to); }
+    void     copyTo (SMap<T>& to) const  { Vec::copyTo((Vec&)to); }
+#endif
 };
 
 
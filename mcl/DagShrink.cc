@@ -253,7 +253,7 @@ static inline void printSigs(const vec<Sig>& xs)
 {
     fprintf(stderr, "{ ");
     for (int i = 0; i < xs.size(); i++)
-        fprintf(stderr, "%s%s%d ", sign(xs[i])?"-":"", type(xs[i]) == gtype_Inp ? "$" : "@", index(gate(xs[i])));
+        fprintf(stderr, "%s%s%"PRIgw" ", sign(xs[i])?"-":"", type(xs[i]) == gtype_Inp ? "$" : "@", index(gate(xs[i])));
     fprintf(stderr, "}");
 }
 
@@ -81,11 +81,20 @@ void Minisat::dadaAdder(Circ& c, vec<vec<Sig> >& columns, vec<Sig>& result)
 
 void Minisat::multiplier(Circ& c, vec<Sig>& xs, vec<Sig>& ys, vec<Sig>& result)
 {
-    vec<vec<Sig> > columns;
+    // Create all partial products in one batch:
+    vec<Sig> as, bs, prods;
     for (int i = 0; i < xs.size(); i++)
         for (int j = 0; j < ys.size(); j++){
+            as.push(xs[i]);
+            bs.push(ys[j]);
+        }
+    c.mkAnds(as, bs, prods);
+
+    vec<vec<Sig> > columns;
+    for (int i = 0, k = 0; i < xs.size(); i++)
+        for (int j = 0; j < ys.size(); j++, k++){
             columns.growTo(i+j+1);
-            columns[i+j].push(c.mkAnd(xs[i], ys[j]));
+            columns[i+j].push(prods[k]);
         }
 
     dadaAdder(c, columns, result);
@@ -97,11 +106,19 @@ void Minisat::multiplier(Circ& c, vec<Sig>& xs, vec<Sig>& ys, vec<Sig>& result)
 
 static void squarer(Circ& c, vec<Sig>& xs, vec<vec<Sig> >& columns)
 {
-    columns.clear();
+    vec<Sig> as, bs, prods;
     for (int i = 0; i < xs.size(); i++)
         for (int j = 0; j < i; j++){
+            as.push(xs[i]);
+            bs.push(xs[j]);
+        }
+    c.mkAnds(as, bs, prods);
+
+    columns.clear();
+    for (int i = 0, k = 0; i < xs.size(); i++)
+        for (int j = 0; j < i; j++, k++){
             columns.growTo(i+j+2);
-            columns[i+j+1].push(c.mkAnd(xs[i], xs[j]));
+            columns[i+j+1].push(prods[k]);
         }
             
     for (int i = 0; i < xs.size(); i++)
@@ -135,7 +152,7 @@ void Minisat::fullAdderCorrect(void)
     Clausifyer<SimpSolver> Cl(c, s);
     Cl.clausify(sum);
     Cl.clausify(carry);
-    printf("Full adder number of gates = %d, number of clauses = %d\n", c.nGates(), s.nClauses());
+    printf("Full adder number of gates = %"PRIgs", number of clauses = %d\n", c.nGates(), s.nClauses());
 
     for (int i = 0; i < 2; i++)
         for (int j = 0; j < 2; j++)
@@ -216,7 +233,7 @@ void Minisat::multiplierCorrect(int size)
     for (int i = 0; i < result.size(); i++)
         Cl.clausify(result[i]);
 
-    printf("Multiplier of size %d number of gates = %d, number of clauses = %d, output bits = %d\n", size, c.nGates(), s.nClauses(), result.size());
+    printf("Multiplier of size %d number of gates = %"PRIgs", number of clauses = %d, output bits = %d\n", size, c.nGates(), s.nClauses(), result.size());
     printf("Multiplier of size %d correct.\n", size);
 }
 
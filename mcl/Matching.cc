@@ -171,8 +171,7 @@ void CircMatcher::matchAnds(const Circ& c, Gate g, vec<Sig>& xs, bool match_muxe
             continue;
 
         g = gate(x);
-        if (tmp_fanouts[g] < 255)
-            tmp_fanouts[g]++;
+        tmp_fanouts[g]++;
         
         if (tmp_fanouts[g] < c.nFanouts(g))
             continue;
@@ -17,139 +17,166 @@ DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
 OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **************************************************************************************************/
 
+#include <pthread.h>
+#include <sys/time.h>
+
 #include "minisat/mtl/Sort.h"
 #include "minisat/utils/System.h"
 #include "mcl/SatSweep.h"
+#include "mcl/SimKey.h"
+#include "mcl/Simulate.h"
 
 using namespace Minisat;
 
 
 //=================================================================================================
-// Implication set:
+// Basic helpers:
 //
 
-class ImplSet
+template<class T>
+static void randomShuffle(double& seed, vec<T>& xs)
 {
-    Circ       hash;
-    SMap<Gate> id_map;
-
-    Gate atom(Sig x){
-        id_map.growTo(x, gate_Undef);
-        if (id_map[x] == gate_Undef)
-            id_map[x] = gate(hash.mkInp());
-        return id_map[x];
-    }
-
-public:
-
-    bool has   (Sig x, Sig y){
-        Gate x_a = atom(x);
-        Gate y_a = atom(y);
+    for (int i = 0; i < xs.size(); i++){
+        int pick = i + irand(seed, xs.size() - i);
 
-        return hash.tryAnd(mkSig(x_a), mkSig(y_a)) != sig_Undef;
-    }
+        assert(pick < xs.size());
 
-    void insert(Sig x, Sig y){
-        Gate x_a = atom(x);
-        Gate y_a = atom(y);
-        hash.mkAnd(mkSig(x_a), mkSig(y_a));
+        T tmp = xs[i];
+        xs[i] = xs[pick];
+        xs[pick] = tmp;
     }
-};
-
-
-//=================================================================================================
-// Basic helpers:
-//
+}
 
-int smallestClass(const Eqs& eqs)
+// The smallest gate index of a class:
+static GateWord minIndex(const vec<Sig>& cls)
 {
-    int i = -1;
-    int i_smallest = 0;
-
-    for (int k = 0; k < eqs.size(); k++){
-        int min_size = index(gate(eqs[k][0]));
-        for (int j = 1; j < eqs[k].size(); j++){
-            int size = index(gate(eqs[k][j]));
-            if (size < min_size)
-                min_size = size;
-        }
-        if (i == -1 || min_size < i_smallest){
-            i = k;
-            i_smallest = min_size;
-        }
-    }
-    assert(i >= 0);
-    assert(i < eqs.size());
-    return i;
+    GateWord min = index(gate(cls[0]));
+    for (int i = 1; i < cls.size(); i++)
+        if (index(gate(cls[i])) < min)
+            min = index(gate(cls[i]));
+    return min;
 }
 
-
-int biggestClass(const Eqs& eqs)
+// Binary heap of class indices, ordered by the smallest gate index of each class:
+class ClassHeap
 {
-    int i = -1;
-    int i_largest = 0;
+    struct Entry { GateWord min; int cls; };
+    vec<Entry> heap;
 
-    for (int k = 0; k < eqs.size(); k++){
-        int max_size = index(gate(eqs[k][0]));
-        for (int j = 1; j < eqs[k].size(); j++){
-            int size = index(gate(eqs[k][j]));
-            if (size > max_size)
-                max_size = size;
-        }
-        if (i == -1 || max_size > i_largest){
-            i = k;
-            i_largest = max_size;
-        }
+    static bool lt(const Entry& a, const Entry& b){ return a.min < b.min || (a.min == b.min && a.cls < b.cls); }
+
+public:
+    int  size () const { return heap.size(); }
+    int  top  () const { return heap[0].cls; }
+    void clear()       { heap.clear(); }
+    void moveTo(ClassHeap& to)       { heap.moveTo(to.heap); }
+    void copyTo(ClassHeap& to) const { heap.copyTo(to.heap); }
+
+    void push(GateWord min, int cls){
+        Entry e; e.min = min; e.cls = cls;
+        int   i = heap.size();
+        heap.push(e);
+        for (; i > 0 && lt(e, heap[(i-1) / 2]); i = (i-1) / 2)
+            heap[i] = heap[(i-1) / 2];
+        heap[i] = e;
     }
-    assert(i >= 0);
-    assert(i < eqs.size());
-    return i;
-}
 
-// (stolen from Solver.h)
-static inline double drand(double& seed) {
-    seed *= 1389796;
-    int q = (int)(seed / 2147483647);
-    seed -= (double)q * 2147483647;
-    return seed / 2147483647; }
+    void pop(){
+        Entry e = heap.last();
+        heap.pop();
+        if (heap.size() == 0) return;
+
+        int i = 0;
+        for (;;){
+            int c = 2*i + 1;
+            if (c >= heap.size()) break;
+            if (c+1 < heap.size() && lt(heap[c+1], heap[c])) c++;
+            if (!lt(heap[c], e)) break;
+            heap[i] = heap[c];
+            i = c;
+        }
+        heap[i] = e;
+    }
+};
 
-// (stolen from Solver.h)
-static inline int irand(double& seed, int size) {
-    return (int)(drand(seed) * size); }
+//=================================================================================================
+// Counterexamples collected by 'EqsWithUnits::falsify()', stored as the patterns of a one-word
+// simulation until 'EqsWithUnits::refineSim()' splits the classes by them:
 
-template<class T>
-static void randomShuffle(double& seed, vec<T>& xs)
-{
-    for (int i = 0; i < xs.size(); i++){
-        int pick = i + irand(seed, xs.size() - i);
+struct SweepCexs {
+    CircSim sim;
+    int     n;                // Number of patterns stored in 'sim'.
+    GSet    cnf_inps;         // Inputs that had a value in some stored counterexample.
+    double  seed;
 
-        assert(pick < xs.size());
+    SweepCexs(const Circ& c) : sim(c, 1), n(0), seed(91648253) {}
+    bool full() const { return n == 64; }
+};
 
-        T tmp = xs[i];
-        xs[i] = xs[pick];
-        xs[pick] = tmp;
+// Store the current model as the next pattern of 'cexs' (inputs without a variable get
+// random values). A model found while the word is full is not stored:
+template<class SomeSolver>
+static void storeCex(const Circ& cin, Clausifyer<SomeSolver>& cl, SweepCexs& cexs)
+{
+    if (cexs.full()) return;
+    for (InpIt iit = cin.inpBegin(); iit != cin.inpEnd(); ++iit){
+        lbool v = cl.modelValue(*iit);
+        if (v != l_Undef)
+            cexs.cnf_inps.insert(*iit);
+        cexs.sim.setPattern(*iit, cexs.n, v == l_Undef ? irand(cexs.seed, 2) : v == l_True);
     }
+    cexs.n++;
 }
 
 //=================================================================================================
 // Invariant representation:
 //
 
+// Classes are kept in the slots of 'eqs' (empty slots are reused), and 'order' holds the slots of
+// all classes ordered by their smallest gate index. Refinement splits classes in place, keeping
+// the part with the smallest gate in the old slot so that its position in 'order' stays valid.
+
 class EqsWithUnits
 {
-    vec<Sig> units;
-    Eqs      eqs;
+    struct FirstLt {
+        const Eqs& eqs;
+        FirstLt(const Eqs& e) : eqs(e){}
+        bool operator()(int i, int j) const { return eqs[i][0] < eqs[j][0] || (eqs[i][0] == eqs[j][0] && i < j); }
+    };
+
+    vec<Sig>  units;
+    vec<Sig>  failed_units;   // Units falsified since the last 'refineSim()'.
+    Eqs       eqs;
+    vec<int>  free_slots;
+    ClassHeap order;
+
+    int  allocSlot() { if (free_slots.size() > 0){ int i = free_slots.last(); free_slots.pop(); return i; } eqs.push(); return eqs.size()-1; }
+    void freeSlot (int i){ eqs[i].clear(); free_slots.push(i); }
+    void splitClass(int i, vec<SimKey>& keys);
 
 public:
     void addUnit (Sig x) { units.push(x); }
-    void addClass(const vec<Sig>& cls){ eqs.push(); cls.copyTo(eqs.last()); }
-
-    void clear() { units.clear(); eqs.clear(); }
-    void moveTo(EqsWithUnits& other){ units.moveTo(other.units); eqs.moveTo(other.eqs); }
-    void copyTo(EqsWithUnits& other){ units.copyTo(other.units); copy(eqs, other.eqs); }
+    void addClass(const vec<Sig>& cls){ int i = allocSlot(); cls.copyTo(eqs[i]); order.push(minIndex(cls), i); }
+    void moveClass(vec<Sig>& cls)     { int i = allocSlot(); order.push(minIndex(cls), i); cls.moveTo(eqs[i]); }
+
+    void clear() { units.clear(); failed_units.clear(); eqs.clear(); free_slots.clear(); order.clear(); }
+    bool empty() const { return units.size() == 0 && failed_units.size() == 0 && order.size() == 0; }
+    void moveTo(EqsWithUnits& other){
+        units.moveTo(other.units); failed_units.moveTo(other.failed_units); eqs.moveTo(other.eqs);
+        free_slots.moveTo(other.free_slots); order.moveTo(other.order); }
+    void copyTo(EqsWithUnits& other){
+        units.copyTo(other.units); failed_units.copyTo(other.failed_units); copy(eqs, other.eqs);
+        free_slots.copyTo(other.free_slots); order.copyTo(other.order); }
 
     int  nUnits()   const { return units.size(); }
-    int  nClasses() const { return eqs.size(); }
+    void members(vec<Sig>& xs) const {
+        xs.clear();
+        append(units, xs);
+        append(failed_units, xs);
+        for (int i = 0; i < eqs.size(); i++)
+            append(eqs[i], xs);
+    }
+    int  nClasses() const { return order.size(); }
     void nonTrivs(int& num, float& avg_size) const {
         int tot   = 0;
 
@@ -163,29 +190,138 @@ public:
     }
 
     template<class SomeSolver>
-    bool falsify(const Circ& cin, SomeSolver& s, Clausifyer<SomeSolver>& cl, EqsWithUnits& proven);
+    bool falsify(const Circ& cin, SomeSolver& s, Clausifyer<SomeSolver>& cl, const SweepBudget& b, double deadline,
+                 EqsWithUnits& proven, EqsWithUnits& undecided, SweepCexs& cexs, SweepStats& st);
 
-    template<class SomeSolver>
-    void refine (const Circ& cin, SomeSolver& s, Clausifyer<SomeSolver>& cl, EqsWithUnits& refined);
+    void addBuckets(vec<SimKey>& keys);
+
+    // Returns the number of classes split (counting the units as one):
+    int  refineSim(const Circ& cin, SweepCexs& cexs);
 
-    void toEqs(Eqs& out){
+    // Classes that share their first member are merged (a proven class and the members of it
+    // that were retried after an undecided query, see 'falsify()'):
+    void toEqs(Eqs& out) const {
         out.clear();
         if (units.size() > 0){
             out.push();
             out.last().push(sig_True);
             append(units, out.last());
         }
-        append(eqs, out);
+        vec<int> slots;
+        for (int i = 0; i < eqs.size(); i++)
+            if (eqs[i].size() > 0)
+                slots.push(i);
+        sort(slots, FirstLt(eqs));
+        for (int i = 0; i < slots.size(); i++)
+            if (i > 0 && eqs[slots[i]][0] == eqs[slots[i-1]][0])
+                for (int j = 1; j < eqs[slots[i]].size(); j++)
+                    out.last().push(eqs[slots[i]][j]);
+            else{
+                out.push();
+                eqs[slots[i]].copyTo(out.last());
+            }
     }        
 };
 
 struct RevSigLt { bool operator()(Sig x, Sig y) const { return y < x; } };
 
+static inline bool timedOut(double deadline){ return deadline >= 0 && cpuTime() > deadline; }
+
+// Solve under the assumptions 'p' and 'q' within the conflict and propagation budgets of 'b'
+// (and count the query in 'st' if given):
+template<class SomeSolver>
+static lbool solveBudget(SomeSolver& s, const SweepBudget& b, Lit p, Lit q = lit_Undef, SweepStats* st = NULL)
+{
+    double   time      = st != NULL ? cpuTime() : 0;
+    uint64_t conflicts = s.conflicts;
+
+    vec<Lit> assumps;
+    assumps.push(p);
+    if (q != lit_Undef)
+        assumps.push(q);
+
+    s.budgetOff();
+    if (b.conf_budget >= 0) s.setConfBudget(b.conf_budget);
+    if (b.prop_budget >= 0) s.setPropBudget(b.prop_budget);
+    lbool res = s.solveLimited(assumps);
+    s.budgetOff();
+
+    if (st != NULL)
+        st->addQuery(res, cpuTime() - time, s.conflicts - conflicts);
+    return res;
+}
+
+
+template<class SomeSolver>
+static bool needsRecycling(const SomeSolver& s, const SweepBudget& budget)
+{
+    return (budget.recycle_clauses >= 0 && (int64_t)s.nClauses() + s.nLearnts() > budget.recycle_clauses)
+        || (budget.recycle_mem >= 0 && memUsed() > budget.recycle_mem);
+}
+
+
+// Check the recycling limits of 'b' if at least 64 queries have been made since the last check
+// (at 'checked' queries of the round). Returns true if the solver should be recycled:
+template<class SomeSolver>
+static bool recycleDue(const SomeSolver& s, const SweepBudget& b, const SweepStats& st, uint64_t& checked)
+{
+    uint64_t n = st.sat_queries + st.unsat_queries + st.undecided_queries;
+    if (n < checked + 64)
+        return false;
+    checked = n;
+    return needsRecycling(s, b);
+}
+
+
+// Split the ring 'cls' by the current model after the link from member 'j' failed: members with
+// the same value as 'cls[0]' are kept, and the others are moved to 'out'. The link between two
+// kept members is proven if all links between them were ('links' holds the links before 'j').
+// Returns the link to try next, from the last kept member before the failed link:
+template<class SomeSolver>
+static int splitRing(Clausifyer<SomeSolver>& cl, vec<Sig>& cls, vec<lbool>& links, int j, vec<Sig>& out)
+{
+    lbool v0   = cl.modelValue(cls[0]);
+    lbool link = l_False;             // The links since the last kept member.
+    int   m    = 0;
+    int   next = 0;
+    for (int k = 0; k < cls.size(); k++){
+        if (k > 0 && k <= j && links[k-1] != l_False)
+            link = l_Undef;
+
+        if (cl.modelValue(cls[k]) != v0)
+            out.push(cls[k]);
+        else{
+            if (k > 0 && k <= j)
+                links[m-1] = link;
+            if (k <= j)
+                next = m;
+            link     = l_False;
+            cls[m++] = cls[k];
+        }
+    }
+    cls.shrink(cls.size() - m);
+    links.shrink(links.size() - next);
+    return next;
+}
+
+
+// Try to falsify the remaining candidates. Each counterexample is stored in 'cexs', and separates
+// a unit, or the members of a class that differ from its representative under it, into a class
+// of its own; the remaining candidates are then tried as before. Returns true when the word of
+// 'cexs' is full or when the solver has outgrown the recycling limits of 'b' (both are checked
+// between units and between classes), and false when all candidates have been proven or moved to
+// 'undecided', or when 'deadline' has passed:
 template<class SomeSolver>
-bool EqsWithUnits::falsify(const Circ&, SomeSolver& s, Clausifyer<SomeSolver>& cl, EqsWithUnits& proven)
+bool EqsWithUnits::falsify(const Circ& cin, SomeSolver& s, Clausifyer<SomeSolver>& cl, const SweepBudget& b, double deadline,
+                           EqsWithUnits& proven, EqsWithUnits& undecided, SweepCexs& cexs, SweepStats& st)
 {
+    vec<lbool> links;
+    vec<Sig>   cls, out, sub, rest;
+    uint64_t   checked = st.sat_queries + st.unsat_queries + st.undecided_queries;
+
     // Find trivial units:
     //
+    double time = cpuTime();
     int i, j;
     for (i = j = 0; i < units.size(); i++){
         Sig x = units[i];
@@ -197,100 +333,286 @@ bool EqsWithUnits::falsify(const Circ&, SomeSolver& s, Clausifyer<SomeSolver>& c
             units[j++] = units[i];
     }
     units.shrink(i - j);
+    st.clausify_time += cpuTime() - time;
 
-    // Find trivial classes:
-    //
-    for (i = j = 0; i < eqs.size(); i++)
-        if (eqs[i].size() == 1)
-            proven.addClass(eqs[i]);
-        else{
-            if (i != j)
-                eqs[i].moveTo(eqs[j]);
-            j++;
-        }
-    eqs.shrink(i - j);
-
-    // Prove remaining units:
+    // Prove remaining units (the falsified ones form a class of their own):
     //
     // sort(units, RevSigLt());
     // sort(units);
     while (units.size() > 0){
-        Sig x = units.last();
-        Lit p = cl.clausify(x);
-        if (s.solve(~p))
+        if (timedOut(deadline))
+            return false;
+        else if (cexs.full() || recycleDue(s, b, st, checked))
             return true;
 
-        proven.addUnit(x);
+        Sig   x    = units.last();
+        double time = cpuTime();
+        Lit   p    = cl.clausify(x);
+        st.clausify_time += cpuTime() - time;
+        lbool res  = solveBudget(s, b, ~p, lit_Undef, &st);
+        if (res == l_True){
+            storeCex(cin, cl, cexs);
+            failed_units.push(x);
+        }else if (res == l_False)
+            proven.addUnit(x);
+        else
+            undecided.addUnit(x);
         units.pop();
     }
+    if (failed_units.size() > 0)
+        moveClass(failed_units);
 
-    // Prove non-unit equivalences:
+    // Prove non-unit equivalences, the class with the smallest gate first:
     //
-    while (eqs.size() > 0){
-        int i = smallestClass(eqs);
-        sort(eqs[i]);
+    while (order.size() > 0){
+        if (timedOut(deadline))
+            return false;
+        else if (cexs.full() || recycleDue(s, b, st, checked))
+            return true;
+
+        int i = order.top();
+        if (eqs[i].size() < 2){
+            // Trivial class (a gate split off by refinement is reported as a class of its own):
+            if (eqs[i].size() == 1)
+                proven.addClass(eqs[i]);
+            order.pop();
+            freeSlot(i);
+            continue; }
+
+        eqs[i].moveTo(cls);
+        sort(cls);
         // This class should not contain units:
         //
-        assert(eqs[i].size() > 1);
-        assert(!find(eqs[i], sig_True));
-
-        for (int j = 0; j < eqs[i].size(); j++){
-            Sig  x     = eqs[i][j];
-            Sig  y     = eqs[i][(j+1) % eqs[i].size()];
-            Lit  x_lit = cl.clausify(x);
-            Lit  y_lit = cl.clausify(y);
-            bool res   = s.solve(x_lit, ~y_lit);
-                
-            if (res) return true;
+        assert(cls.size() > 1);
+        assert(!find(cls, sig_True));
+
+        // Prove the ring of implications 'x0 -> x1 -> .. -> x0' (a counterexample to a link moves
+        // members to 'out', and the ring is continued over the rest):
+        links.clear();
+        out  .clear();
+        for (int j = 0; cls.size() > 1 && j < cls.size();){
+            double time = cpuTime();
+            Lit   x_lit = cl.clausify(cls[j]);
+            Lit   y_lit = cl.clausify(cls[(j+1) % cls.size()]);
+            st.clausify_time += cpuTime() - time;
+            lbool res   = solveBudget(s, b, x_lit, ~y_lit, &st);
+
+            if (res == l_True){
+                storeCex(cin, cl, cexs);
+                j = splitRing(cl, cls, links, j, out);
+            }else{
+                links.push(res);
+                j++;
+            }
         }
-        proven.addClass(eqs[i]);
-        
-        if (i < eqs.size()-1)
-            eqs.last().moveTo(eqs[i]);
-        eqs.pop();
+
+        if (find(links, l_Undef)){
+            // Some links are undecided. Members that are still proven equal to the representative
+            // 'x0' (through the ring or by direct queries) stay in a proven class, and the others are
+            // retried later together with 'x0' (see 'toEqs()'):
+            int      n    = cls.size();
+            Lit      rep  = cl.lookup(cls[0]);
+            sub .clear();
+            rest.clear();
+            sub .push(cls[0]);
+            rest.push(cls[0]);
+            for (int j = 1; j < n; j++){
+                bool fwd = true, bwd = true;
+                for (int k = 0; k < j; k++) fwd &= links[k] == l_False;
+                for (int k = j; k < n; k++) bwd &= links[k] == l_False;
+
+                Lit   x_lit = cl.lookup(cls[j]);
+                lbool res   = l_False;
+                if (!fwd) fwd = (res = solveBudget(s, b, rep, ~x_lit, &st)) == l_False;
+                if (!bwd && res != l_True) bwd = (res = solveBudget(s, b, x_lit, ~rep, &st)) == l_False;
+
+                if (res == l_True){
+                    storeCex(cin, cl, cexs);
+                    out.push(cls[j]);
+                }else
+                    (fwd && bwd ? sub : rest).push(cls[j]);
+            }
+            proven.addClass(sub);
+            if (rest.size() > 1)
+                undecided.moveClass(rest);
+        }else
+            proven.addClass(cls);
+        order.pop();
+        freeSlot(i);
+        if (out.size() > 0)
+            moveClass(out);
     }
 
     return false;
 }
 
 
-template<class SomeSolver>
-void EqsWithUnits::refine(const Circ&, SomeSolver&, Clausifyer<SomeSolver>& cl, EqsWithUnits& refined)
-{
-    vec<Sig> class_t;
-    vec<Sig> class_f;
-    for (int i = 0; i < units.size(); i++)
-        if (cl.modelValue(units[i]) == l_True)
-            refined.addUnit(units[i]);
-        else if (cl.modelValue(units[i]) == l_False)
-            class_f.push(units[i]);
-        else{
-            printf("(REFINE) All gates should have values! x = %s%d\n", sign(units[i])?"-":"", index(gate(units[i])));
-            assert(false);
-        }
-    if (class_f.size() > 0)
-        refined.addClass(class_f);
-
-    for (int i = 0; i < eqs.size(); i++){
-        class_t.clear();
-        class_f.clear();
-        for (int j = 0; j < eqs[i].size(); j++){
-            Sig x = eqs[i][j];
-
-            if (cl.modelValue(x) == l_True)
-                class_t.push(x);
-            else if (cl.modelValue(x) == l_False)
-                class_f.push(x);
-            else{
-                printf("(REFINE) All gates should have values! x = %s%d\n", sign(x)?"-":"", index(gate(x)));
-                assert(false);
-            }
+// Simulate the counterexamples of 'cexs' and split the units and all classes by them. A word that
+// is not full is padded with distance-1 neighbours of the stored patterns, each flipping one input
+// that had a value in some counterexample:
+int EqsWithUnits::refineSim(const Circ& cin, SweepCexs& cexs)
+{
+    if (cexs.n == 0)
+        return 0;
+
+    CircSim& sim = cexs.sim;
+    if (!cexs.full()){
+        for (InpIt iit = cin.inpBegin(); iit != cin.inpEnd(); ++iit){
+            uint64_t w = sim.word(mkSig(*iit), 0) & (((uint64_t)1 << cexs.n) - 1);
+            for (int m = cexs.n; m < 64; m *= 2)
+                w |= w << m;
+            sim.setInput(*iit, 0, w);
+        }
+        for (int k = cexs.n; k < 64 && cexs.cnf_inps.size() > 0; k++){
+            Gate g = cexs.cnf_inps[irand(cexs.seed, cexs.cnf_inps.size())];
+            sim.setInput(g, 0, sim.word(mkSig(g), 0) ^ ((uint64_t)1 << k));
+        }
+    }
+    sim.simulate();
+    cexs.n = 0;
+    cexs.cnf_inps.clear();
+
+    // Split units and classes by their words (the falsified units are bucketed together with the
+    // units split off here):
+    int         n_split = 0;
+    vec<SimKey> keys;
+    int i, j;
+    for (i = j = 0; i < units.size(); i++)
+        if (sim.word(units[i], 0) == ~(uint64_t)0)
+            units[j++] = units[i];
+        else
+            keys.push(mkSimKey(sim.word(units[i], 0), units[i]));
+    units.shrink(i - j);
+    for (i = 0; i < failed_units.size(); i++)
+        keys.push(mkSimKey(sim.word(failed_units[i], 0), failed_units[i]));
+    failed_units.clear();
+    if (keys.size() > 0){
+        addBuckets(keys);
+        n_split++; }
+
+    for (int i = 0, n = eqs.size(); i < n; i++){
+        if (eqs[i].size() < 2) continue;
+
+        uint64_t w0 = sim.word(eqs[i][0], 0);
+        int      j;
+        for (j = 1; j < eqs[i].size() && sim.word(eqs[i][j], 0) == w0; j++)
+            ;
+        if (j < eqs[i].size()){
+            keys.clear();
+            for (j = 0; j < eqs[i].size(); j++)
+                keys.push(mkSimKey(sim.word(eqs[i][j], 0), eqs[i][j]));
+            splitClass(i, keys);
+            n_split++;
         }
-        if (class_t.size() > 0) refined.addClass(class_t);
-        if (class_f.size() > 0) refined.addClass(class_f);
     }
 
-    // printf("refining (%d, %d) => (%d, %d)\n", nUnits(), nClasses(), refined.nUnits(), refined.nClasses());
+    return n_split;
+}
+
+
+// Add one class for each run of equal keys (sorting them first):
+void EqsWithUnits::addBuckets(vec<SimKey>& keys)
+{
+    sort(keys, SimKeyLt());
+    vec<Sig> cls;
+    for (int i = 0, j; i < keys.size(); i = j){
+        cls.clear();
+        for (j = i; j < keys.size() && keys[j].sig == keys[i].sig; j++)
+            cls.push(keys[j].x);
+        addClass(cls);
+    }
+}
+
+
+// Split the class in slot 'i' by the keys of its members. The part with the smallest gate stays
+// in slot 'i' (which keeps its place in 'order'), and the other parts become new classes:
+void EqsWithUnits::splitClass(int i, vec<SimKey>& keys)
+{
+    GateWord min     = minIndex(eqs[i]);
+    uint64_t min_key = 0;
+    for (int j = 0; j < keys.size(); j++)
+        if (index(gate(keys[j].x)) == min)
+            min_key = keys[j].sig;
+
+    sort(keys, SimKeyLt());
+    eqs[i].clear();
+    vec<Sig> cls;
+    for (int j = 0, k; j < keys.size(); j = k){
+        cls.clear();
+        for (k = j; k < keys.size() && keys[k].sig == keys[j].sig; k++)
+            cls.push(keys[k].x);
+        if (keys[j].sig == min_key)
+            cls.copyTo(eqs[i]);
+        else
+            addClass(cls);
+    }
+}
+
+
+void SweepStats::clear()
+{
+    sat_queries = unsat_queries = undecided_queries = 0;
+    for (int i = 0; i < n_hist; i++)
+        time_hist[i] = conf_hist[i] = 0;
+    clausify_time = solve_time = refine_time = simp_time = 0;
+    classes_split = recycles = 0;
+    cand_units = cand_classes = proven_units = proven_classes = 0;
+    mem_used = 0;
+}
+
+
+void SweepStats::addQuery(lbool res, double time, uint64_t conflicts)
+{
+    if      (res == l_True)  sat_queries++;
+    else if (res == l_False) unsat_queries++;
+    else                     undecided_queries++;
+    solve_time += time;
+
+    int t = 0, c = 0;
+    for (double limit = 0.000001; t < n_hist-1 && time >= limit; limit *= 10)
+        t++;
+    for (uint64_t limit = 1; c < n_hist-1 && conflicts >= limit; limit = limit == 1 ? 10 : limit * 10)
+        c++;
+    time_hist[t]++;
+    conf_hist[c]++;
+}
+
+
+void Minisat::printSweepStatsJson(const SweepStats& st, void* data)
+{
+    FILE* out = (FILE*)data;
+    fprintf(out, "{\"round\":%d,\"final\":%s,\"sat\":%"PRIu64",\"unsat\":%"PRIu64",\"undecided\":%"PRIu64",",
+            st.round, st.final ? "true" : "false", st.sat_queries, st.unsat_queries, st.undecided_queries);
+    fprintf(out, "\"time_hist\":[");
+    for (int i = 0; i < SweepStats::n_hist; i++)
+        fprintf(out, "%s%"PRIu64, i > 0 ? "," : "", st.time_hist[i]);
+    fprintf(out, "],\"conf_hist\":[");
+    for (int i = 0; i < SweepStats::n_hist; i++)
+        fprintf(out, "%s%"PRIu64, i > 0 ? "," : "", st.conf_hist[i]);
+    fprintf(out, "],\"clausify_time\":%g,\"solve_time\":%g,\"refine_time\":%g,\"simp_time\":%g,\"classes_split\":%d,\"recycles\":%d,",
+            st.clausify_time, st.solve_time, st.refine_time, st.simp_time, st.classes_split, st.recycles);
+    fprintf(out, "\"cand_units\":%d,\"cand_classes\":%d,\"proven_units\":%d,\"proven_classes\":%d,\"mem_used\":%g}\n",
+            st.cand_units, st.cand_classes, st.proven_units, st.proven_classes, st.mem_used);
+    fflush(out);
+}
+
+
+// Complete the statistics of a round, pass them on and start the next round:
+static void reportRound(SweepStats& st, int round, bool final, const EqsWithUnits& curr, const EqsWithUnits& proven,
+                        SweepCallback callback, void* callback_data)
+{
+    if (callback != NULL){
+        float avg_size;
+        st.final        = final;
+        st.cand_units   = curr.nUnits();
+        st.proven_units = proven.nUnits();
+        curr  .nonTrivs(st.cand_classes,   avg_size);
+        proven.nonTrivs(st.proven_classes, avg_size);
+        st.mem_used     = memUsed();
+        callback(st, callback_data);
+    }
+    st.clear();
+    st.round = round;
 }
 
 
@@ -326,7 +648,20 @@ static void printStatistics(int iters, const Solv& s, const EqsWithUnits& cands,
            );
 }
 
-int Minisat::satSweep(Circ& cin, Clausifyer<Solver>& cl, Solver& s, const Eqs& eqs_in, Eqs& eqs_out, int verbosity)
+// Multiply the budgets of 'b' before retrying the candidates in 'undecided':
+static void escalateBudget(SweepBudget& b, int n_units, int n_classes, int verbosity)
+{
+    // (make sure that a budget grows even when it is very small)
+    if (b.conf_budget >= 0) b.conf_budget = (int64_t)(b.conf_budget * b.escalate) + 1;
+    if (b.prop_budget >= 0) b.prop_budget = (int64_t)(b.prop_budget * b.escalate) + 1;
+
+    if (verbosity >= 1)
+        printf("| Undecided: %d units, %d classes; new budgets: %"PRId64" conflicts, %"PRId64" propagations\n",
+               n_units, n_classes, b.conf_budget, b.prop_budget);
+}
+
+int Minisat::satSweep(Circ& cin, Clausifyer<Solver>& cl, Solver& s, const Eqs& eqs_in, Eqs& eqs_out, int verbosity,
+                      const SweepBudget& budget, SweepCallback callback, void* callback_data)
 {
     if (verbosity >= 1){
         printf("=================================[ SAT Sweeping ]=============================================\n");
@@ -344,9 +679,12 @@ int Minisat::satSweep(Circ& cin, Clausifyer<Solver>& cl, Solver& s, const Eqs& e
 
     // Clausify all gates referred to in some equivalence:
     //
+    SweepStats st;
+    double     time = cpuTime();
     for (int i = 0; i < eqs_in.size(); i++)
         for (int j = 0; j < eqs_in[i].size(); j++)
             cl.clausify(eqs_in[i][j]);
+    st.clausify_time += cpuTime() - time;
 
 
     EqsWithUnits proven;
@@ -364,28 +702,100 @@ int Minisat::satSweep(Circ& cin, Clausifyer<Solver>& cl, Solver& s, const Eqs& e
 
     if (verbosity >= 1) printStatistics(-1, s, curr, proven);
 
-    // Iterate prove/refinement loop:
+    // Iterate prove/refinement loop (counterexamples are collected 64 at a time and resimulated to
+    // refine many classes at once; a word that is not full is used before the undecided candidates
+    // are retried):
     //
     // EqsWithUnits next;
-    int refines = 0;
-    for (;;)
-        if (curr.falsify(cin, s, cl, proven)){
+    SweepCexs    cexs(cin);
+    int          refines  = 0;
+    SweepBudget  b        = budget;
+    double       deadline = budget.time_budget < 0 ? -1 : cpuTime() + budget.time_budget;
+    EqsWithUnits undecided;
+    b.recycle_clauses = b.recycle_mem = -1;   // (only the 'SimpSolver' version recycles its solver)
+    for (;;){
+        if (!curr.falsify(cin, s, cl, b, deadline, proven, undecided, cexs, st)){
+            if (!timedOut(deadline) && !undecided.empty() && b.escalate > 1){
+                escalateBudget(b, undecided.nUnits(), undecided.nClasses(), verbosity);
+                undecided.moveTo(curr);
+            }else{
+                reportRound(st, refines, true, curr, proven, callback, callback_data);
+                if (verbosity >= 1) printStatistics(refines, s, curr, proven);
+                if (verbosity >= 1 && timedOut(deadline)) printf("| Time budget exhausted.\n");
+                break;
+            }
+        }
+
+        if (cexs.n > 0){
             refines++;
-            EqsWithUnits apa;
-            curr.refine(cin, s, cl, apa);
-            apa.moveTo(curr);
-            if (verbosity >= 1) printStatistics(refines, s, curr, proven);
-        }else{
+            double time = cpuTime();
+            st.classes_split = curr.refineSim(cin, cexs);
+            st.refine_time  += cpuTime() - time;
+            reportRound(st, refines, false, curr, proven, callback, callback_data);
             if (verbosity >= 1) printStatistics(refines, s, curr, proven);
-            break;
         }
+    }
 
     proven.toEqs(eqs_out);
     return refines;
 }
 
 
-int Minisat::satSweep(Circ& cin, Clausifyer<SimpSolver>& cl, SimpSolver& s, const Eqs& eqs_in, Eqs& eqs_out, int verbosity)
+// Freeze (or unfreeze) the variables of the gates in 'gs':
+static void setFrozen(Clausifyer<SimpSolver>& cl, SimpSolver& s, const GSet& gs, bool b)
+{
+    for (int i = 0; i < gs.size(); i++)
+        s.setFrozen(var(cl.clausify(gs[i])), b);
+}
+
+
+// A fresh solver for the remaining candidates, that also knows the equivalences proven so far:
+struct SweepSolver {
+    SimpSolver             s;
+    Clausifyer<SimpSolver> cl;
+    SweepSolver(const Circ& c) : cl(c, s) {}
+};
+
+
+static SweepSolver* recycleSolver(const Circ& cin, const EqsWithUnits& curr, const EqsWithUnits& undecided, const EqsWithUnits& proven, GSet& frozen)
+{
+    SweepSolver* fresh = new SweepSolver(cin);
+    SimpSolver&  s     = fresh->s;
+
+    // Clausify the cones of the remaining candidates:
+    vec<Sig> xs;
+    frozen.clear();
+    curr.members(xs);
+    for (int i = 0; i < xs.size(); i++)
+        frozen.insert(gate(xs[i]));
+    undecided.members(xs);
+    for (int i = 0; i < xs.size(); i++)
+        frozen.insert(gate(xs[i]));
+    setFrozen(fresh->cl, s, frozen, true);
+
+    // Add the proven equivalences between gates that got variables:
+    Eqs eqs;
+    proven.toEqs(eqs);
+    for (int i = 0; i < eqs.size(); i++)
+        for (int j = 1; j < eqs[i].size(); j++){
+            Lit x = eqs[i][0] == sig_True ? lit_Undef : fresh->cl.lookup(eqs[i][0]);
+            Lit y = fresh->cl.lookup(eqs[i][j]);
+            if (y == lit_Undef)
+                continue;
+            else if (eqs[i][0] == sig_True)
+                s.addClause(y);
+            else if (x != lit_Undef){
+                s.addClause(~x, y);
+                s.addClause(x, ~y); }
+        }
+
+    s.eliminate();
+    return fresh;
+}
+
+
+int Minisat::satSweep(Circ& cin, Clausifyer<SimpSolver>& cl_in, SimpSolver& s_in, const Eqs& eqs_in, Eqs& eqs_out, int verbosity,
+                      const SweepBudget& budget, SweepCallback callback, void* callback_data)
 {
     if (verbosity >= 1){
         printf("=================================[ SAT Sweeping ]=============================================\n");
@@ -394,6 +804,11 @@ int Minisat::satSweep(Circ& cin, Clausifyer<SimpSolver>& cl, SimpSolver& s, cons
         printf("|  TRIV  SIZE UNITS |  TRIV  SIZE UNITS |          VARS   CLAUSES ITER SOLVS CONFLS |        |\n");
         printf("==============================================================================================\n"); }
 
+    // The current solver and clausifyer (the ones given until the first recycling):
+    SimpSolver*             sp    = &s_in;
+    Clausifyer<SimpSolver>* clp   = &cl_in;
+    SweepSolver*            owned = NULL;
+
     // Make sure that all gates refered to by some signal in 'eqs_in'
     // are given a variable in the Clausifyer. This could be done
     // nicer I suppose:
@@ -403,15 +818,14 @@ int Minisat::satSweep(Circ& cin, Clausifyer<SimpSolver>& cl, SimpSolver& s, cons
 
     // Clausify all gates referred to in some equivalence:
     //
-    GSet frozen;
+    SweepStats st;
+    double     time = cpuTime();
+    GSet       frozen;
     for (int i = 0; i < eqs_in.size(); i++)
-        for (int j = 0; j < eqs_in[i].size(); j++){
-            Gate g = gate(eqs_in[i][j]);
-            Lit  p = cl.clausify(g);
-
-            s.setFrozen(var(p), true);
-            frozen.insert(g);
-        }
+        for (int j = 0; j < eqs_in[i].size(); j++)
+            frozen.insert(gate(eqs_in[i][j]));
+    setFrozen(cl_in, s_in, frozen, true);
+    st.clausify_time += cpuTime() - time;
 
 
     EqsWithUnits proven;
@@ -427,40 +841,77 @@ int Minisat::satSweep(Circ& cin, Clausifyer<SimpSolver>& cl, SimpSolver& s, cons
             // Other classes class:
             curr.addClass(eqs_in[i]);
 
-    if (verbosity >= 1) printStatistics(-1, s, curr, proven);
-    s.eliminate();
-    if (verbosity >= 1) printStatistics(-1, s, curr, proven);
+    if (verbosity >= 1) printStatistics(-1, *sp, curr, proven);
+    time = cpuTime();
+    sp->eliminate();
+    st.simp_time += cpuTime() - time;
+    if (verbosity >= 1) printStatistics(-1, *sp, curr, proven);
 
-    // Iterate prove/refinement loop:
+    // Iterate prove/refinement loop (counterexamples are collected 64 at a time and resimulated to
+    // refine many classes at once; a word that is not full is used before the undecided candidates
+    // are retried):
     //
-    // EqsWithUnits next;
-    int refines = 0;
-    int assigns = s.nAssigns();
-    for (;;)
-        if (curr.falsify(cin, s, cl, proven)){
-            refines++;
-            EqsWithUnits apa;
-            curr.refine(cin, s, cl, apa);
-            apa.moveTo(curr);
-            if (assigns < s.nAssigns()){
-                s.eliminate();
-                assigns = s.nAssigns();
+    SweepCexs    cexs(cin);
+    int          refines  = 0;
+    SweepBudget  b        = budget;
+    double       deadline = budget.time_budget < 0 ? -1 : cpuTime() + budget.time_budget;
+    EqsWithUnits undecided;
+    int assigns = sp->nAssigns();
+    for (;;){
+        bool paused = curr.falsify(cin, *sp, *clp, b, deadline, proven, undecided, cexs, st);
+        if (!paused){
+            if (!timedOut(deadline) && !undecided.empty() && b.escalate > 1){
+                escalateBudget(b, undecided.nUnits(), undecided.nClasses(), verbosity);
+                undecided.moveTo(curr);
+            }else{
+                reportRound(st, refines, true, curr, proven, callback, callback_data);
+                if (verbosity >= 1) printStatistics(refines, *sp, curr, proven);
+                if (verbosity >= 1 && timedOut(deadline)) printf("| Time budget exhausted.\n");
+                break;
             }
-            if (verbosity >= 1) printStatistics(refines, s, curr, proven);
-        }else{
-            if (verbosity >= 1) printStatistics(refines, s, curr, proven);
-            break;
         }
 
+        bool refined = cexs.full() || (!paused && cexs.n > 0);
+        if (refined){
+            refines++;
+            double time = cpuTime();
+            st.classes_split = curr.refineSim(cin, cexs);
+            st.refine_time  += cpuTime() - time;
+        }
+
+        // Recycle the solver whenever 'falsify()' stops (which it also does between queries
+        // when the solver has grown too large):
+        time = cpuTime();
+        if (needsRecycling(*sp, b)){
+            if (owned == NULL)
+                setFrozen(cl_in, s_in, frozen, false);
+            SweepSolver* fresh = recycleSolver(cin, curr, undecided, proven, frozen);
+            delete owned;
+            owned   = fresh;
+            sp      = &owned->s;
+            clp     = &owned->cl;
+            assigns = sp->nAssigns();
+            st.recycles++;
+            if (verbosity >= 1) printf("| Recycled the solver.\n");
+        }else if (assigns < sp->nAssigns()){
+            sp->eliminate();
+            assigns = sp->nAssigns();
+        }
+        st.simp_time += cpuTime() - time;
+
+        if (refined){
+            reportRound(st, refines, false, curr, proven, callback, callback_data);
+            if (verbosity >= 1) printStatistics(refines, *sp, curr, proven);
+        }
+    }
+
     proven.toEqs(eqs_out);
 
     // Unfreeze variables:
     //
-    for (int i = 0; i < frozen.size(); i++){
-        Gate g = frozen[i];
-        Lit  p = cl.clausify(g);
-        s.setFrozen(var(p), false);
-    }
+    if (owned == NULL)
+        setFrozen(cl_in, s_in, frozen, false);
+    delete owned;
 
     return refines;
 }
@@ -488,3 +939,1051 @@ void Minisat::makeUnitClass(const Circ& cin, Eqs& unit)
         cls.push(mkSig(*git, !val[*git]));
 }
 
+
+
+//=================================================================================================
+// Simulation based candidate equivalences:
+//
+
+static bool equalWords(const CircSim& sim, Sig x, Sig y)
+{
+    for (int w = 0; w < sim.nWords(); w++)
+        if (sim.word(x, w) != sim.word(y, w))
+            return false;
+    return true;
+}
+
+
+// Simulate '64 * n_words' random patterns, and group all gates with equal (or complementary) values
+// in all patterns into candidate classes. Gates are bucketed by their signatures first, and only
+// compared exactly within a bucket. Gates that are constant in all patterns end up in the class of
+// 'sig_True', as for 'makeUnitClass()'. Classes with only one member are left out.
+void Minisat::makeSimClasses(const Circ& cin, Eqs& eqs, int n_words)
+{
+    CircSim sim(cin, n_words);
+    sim.randomizeInputs();
+    sim.simulate();
+
+    // Every signal is normalized to be false in the first pattern:
+    vec<SimKey> keys;
+    keys.push(mkSimKey(sim.signature(gate_True), sig_False));
+    for (GateIt git = cin.begin(); git != cin.end(); ++git)
+        keys.push(mkSimKey(sim.signature(*git), mkSig(*git, sim.phase(*git))));
+    sort(keys, SimKeyLt());
+
+    eqs.clear();
+    vec<Sig> bucket, rest;
+    for (int i = 0, j; i < keys.size(); i = j){
+        bucket.clear();
+        for (j = i; j < keys.size() && keys[j].sig == keys[i].sig; j++)
+            bucket.push(keys[j].x);
+
+        // Split the bucket in case of hash collisions:
+        while (bucket.size() > 1){
+            rest.clear();
+            eqs.push();
+            vec<Sig>& cls = eqs.last();
+            for (int k = 0; k < bucket.size(); k++)
+                if (k == 0 || equalWords(sim, bucket[0], bucket[k]))
+                    cls.push(bucket[k]);
+                else
+                    rest.push(bucket[k]);
+
+            if (cls[0] == sig_False)
+                for (int k = 0; k < cls.size(); k++)
+                    cls[k] = ~cls[k];
+            if (cls.size() == 1)
+                eqs.pop();
+            rest.moveTo(bucket);
+        }
+    }
+}
+
+
+//=================================================================================================
+// Parallel SAT sweeping:
+//
+//   Works in rounds. In each round every candidate class is a task, and the tasks are handed out to
+//   the workers through per-worker queues (a worker that runs out of tasks steals from the others).
+//   Each worker owns a solver and a clausifyer over the shared circuit, which is only read while
+//   the workers run. Units are tasks of the form '{sig_True, x}'. A failed task returns the inputs
+//   of its counterexample. A task with undecided links is split by direct queries against its
+//   representative as in 'satSweep()' (a partial task), so that only the undecided members are
+//   retried. After the round, all counterexamples are simulated at once and used to split the
+//   failed classes, and the proven classes are passed on to all solvers as clauses. The worker
+//   threads are started once; the calling thread acts as worker 0, and rounds are separated by a
+//   barrier (as in 'CircSim::setThreads()').
+
+enum { task_Proven = 0, task_Failed = 1, task_Undecided = 2, task_Partial = 3 };
+
+struct SweepQueue {
+    pthread_mutex_t lock;
+    vec<int>        tasks;
+    int             head;             // Tasks before 'head' have been stolen.
+};
+
+struct SweepShared {
+    const Circ*        circ;
+    const Eqs*         tasks;
+    const Eqs*         proven;
+    const SweepBudget* budget;        // Per-query budgets of the current round.
+    double             deadline;      // Real time at which to stop ('-1' for none).
+    vec<char>          result;        // Per task (each task is written by only one worker).
+    vec<vec<char> >    members;       // Per member of a partial task, relative to its first member.
+    SweepQueue*        queues;
+    int                n_workers;
+
+    pthread_mutex_t    start;         // Held while the threads are created.
+    pthread_barrier_t  barrier;
+    volatile bool      quit;
+};
+
+struct SweepWorker {
+    SweepShared*       shared;
+    int                id;
+    Solver             solver;
+    Clausifyer<Solver> cl;
+    int                n_proven;      // Number of proven classes added to 'solver'.
+    vec<lbool>         links;         // Links of the current task.
+    vec<int>           cex_task;      // Failed tasks of this round ...
+    vec<lbool>         cex_inps;      // ... and the values of all inputs in each of them.
+    SweepStats         stats;         // Queries of this round.
+    pthread_t          thread;
+
+    SweepWorker(const Circ& c) : cl(c, solver), n_proven(0) {}
+};
+
+
+static double sweepRealTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1000000;
+}
+
+
+static int sweepPopTask(SweepShared& sh, int id)
+{
+    int t = -1;
+
+    // Take from the back of the own queue:
+    SweepQueue& q = sh.queues[id];
+    pthread_mutex_lock(&q.lock);
+    if (q.tasks.size() > q.head){
+        t = q.tasks.last();
+        q.tasks.pop(); }
+    pthread_mutex_unlock(&q.lock);
+
+    // Steal from the front of some other queue:
+    for (int i = 1; t < 0 && i < sh.n_workers; i++){
+        SweepQueue& v = sh.queues[(id + i) % sh.n_workers];
+        pthread_mutex_lock(&v.lock);
+        if (v.tasks.size() > v.head)
+            t = v.tasks[v.head++];
+        pthread_mutex_unlock(&v.lock);
+    }
+
+    return t;
+}
+
+
+// Solve under the assumptions 'p' and 'q' within the budgets of the round, and count the query:
+static lbool sweepQuery(SweepWorker& w, Lit p, Lit q)
+{
+    double   time      = sweepRealTime();
+    uint64_t conflicts = w.solver.conflicts;
+    lbool    res       = solveBudget(w.solver, *w.shared->budget, p, q);
+    w.stats.addQuery(res, sweepRealTime() - time, w.solver.conflicts - conflicts);
+    return res;
+}
+
+
+// Store the model of the last query as a counterexample of task 't':
+static void sweepCex(SweepWorker& w, int t)
+{
+    w.cex_task.push(t);
+    for (InpIt iit = w.shared->circ->inpBegin(); iit != w.shared->circ->inpEnd(); ++iit)
+        w.cex_inps.push(w.cl.modelValue(*iit));
+}
+
+
+// The work of one round for worker 'w':
+static void sweepRound(SweepWorker& w)
+{
+    SweepShared& sh = *w.shared;
+
+    // Add equivalences proven in earlier rounds (for gates that already have variables):
+    for (; w.n_proven < sh.proven->size(); w.n_proven++){
+        const vec<Sig>& cls = (*sh.proven)[w.n_proven];
+        for (int i = 1; i < cls.size(); i++){
+            Lit x = w.cl.lookup(cls[0]);
+            Lit y = w.cl.lookup(cls[i]);
+            if (x != lit_Undef && y != lit_Undef){
+                w.solver.addClause(~x, y);
+                w.solver.addClause(x, ~y); }
+        }
+    }
+
+    w.cex_task.clear();
+    w.cex_inps.clear();
+    w.stats.clear();
+    for (int t; (t = sweepPopTask(sh, w.id)) >= 0;){
+        // Out of time: drain the queues, leaving the rest undecided:
+        if (sh.deadline >= 0 && sweepRealTime() > sh.deadline){
+            sh.result[t] = task_Undecided;
+            continue; }
+
+        // Prove the ring of the task, past undecided links:
+        const vec<Sig>& cls = (*sh.tasks)[t];
+        w.links.clear();
+        for (int j = 0; j < cls.size(); j++){
+            double time = sweepRealTime();
+            Lit    x    = w.cl.clausify(cls[j]);
+            Lit    y    = w.cl.clausify(cls[(j+1) % cls.size()]);
+            w.stats.clausify_time += sweepRealTime() - time;
+
+            lbool res = sweepQuery(w, x, ~y);
+            if (res == l_True){
+                sh.result[t] = task_Failed;
+                sweepCex(w, t);
+                break; }
+            w.links.push(res);
+        }
+        if (sh.result[t] == task_Failed || !find(w.links, l_Undef))
+            continue;
+
+        // Some links are undecided. Members that are still proven equal to the representative
+        // (through the ring or by direct queries) are proven, and the others are retried later
+        // together with it, or split off by their counterexamples:
+        int        n       = cls.size();
+        Lit        rep     = w.cl.lookup(cls[0]);
+        vec<char>& members = sh.members[t];
+        sh.result[t] = task_Partial;
+        members.growTo(n, task_Proven);
+        for (int j = 1; j < n; j++){
+            bool fwd = true, bwd = true;
+            for (int k = 0; k < j; k++) fwd &= w.links[k] == l_False;
+            for (int k = j; k < n; k++) bwd &= w.links[k] == l_False;
+
+            Lit   x   = w.cl.lookup(cls[j]);
+            lbool res = l_False;
+            if (!fwd) fwd = (res = sweepQuery(w, rep, ~x)) == l_False;
+            if (!bwd && res != l_True) bwd = (res = sweepQuery(w, x, ~rep)) == l_False;
+
+            if (res == l_True){
+                sweepCex(w, t);
+                members[j] = task_Failed;
+            }else if (!fwd || !bwd)
+                members[j] = task_Undecided;
+        }
+    }
+}
+
+
+static void* sweepWorkerMain(void* arg)
+{
+    SweepWorker& w  = *(SweepWorker*)arg;
+    SweepShared& sh = *w.shared;
+
+    // Wait until all threads are created (or the creation failed):
+    pthread_mutex_lock(&sh.start);
+    pthread_mutex_unlock(&sh.start);
+    if (sh.quit)
+        return NULL;
+
+    for (;;){
+        pthread_barrier_wait(&sh.barrier);
+        if (sh.quit)
+            break;
+        sweepRound(w);
+        pthread_barrier_wait(&sh.barrier);
+    }
+    return NULL;
+}
+
+
+// Add 'cls' as tasks, splitting a class of units into one task per unit. The members of a task are
+// sorted, so that its representative is its smallest member. A trivial class is reported as a
+// proven class of its own (as in 'satSweep()'):
+static void addSweepTasks(const vec<Sig>& cls, Eqs& tasks, Eqs& proven)
+{
+    if (find(cls, sig_True)){
+        for (int i = 0; i < cls.size(); i++)
+            if (cls[i] != sig_True){
+                tasks.push();
+                tasks.last().push(sig_True);
+                tasks.last().push(cls[i]);
+            }
+    }else if (cls.size() > 0){
+        Eqs& to = cls.size() > 1 ? tasks : proven;
+        to.push();
+        cls.copyTo(to.last());
+        sort(to.last());
+    }
+}
+
+
+// Split each class by the simulated values of its members (members split off alone are kept as
+// classes of their own):
+static void splitBySim(const CircSim& sim, const Eqs& in, Eqs& out)
+{
+    vec<SimKey> keys;
+    for (int i = 0; i < in.size(); i++){
+        keys.clear();
+        for (int j = 0; j < in[i].size(); j++)
+            keys.push(mkSimKey(sim.hash(in[i][j]), in[i][j]));
+        sort(keys, SimKeyLt());
+        for (int j = 0, k; j < keys.size(); j = k){
+            out.push();
+            for (k = j; k < keys.size() && keys[k].sig == keys[j].sig; k++)
+                out.last().push(keys[k].x);
+        }
+    }
+}
+
+
+// Add the counts of one worker's round to 'to':
+static void addSweepStats(SweepStats& to, const SweepStats& from)
+{
+    to.sat_queries       += from.sat_queries;
+    to.unsat_queries     += from.unsat_queries;
+    to.undecided_queries += from.undecided_queries;
+    for (int i = 0; i < SweepStats::n_hist; i++){
+        to.time_hist[i] += from.time_hist[i];
+        to.conf_hist[i] += from.conf_hist[i]; }
+    to.clausify_time     += from.clausify_time;
+    to.solve_time        += from.solve_time;
+}
+
+
+// Number of unit tasks and of class tasks in 'tasks':
+static void countTasks(const Eqs& tasks, int& n_units, int& n_classes)
+{
+    n_units = n_classes = 0;
+    for (int i = 0; i < tasks.size(); i++)
+        if (tasks[i][0] == sig_True) n_units++;
+        else                         n_classes++;
+}
+
+
+// Stop the threads of workers '1..n_started' and free everything. If 'running' is false the threads
+// are still waiting for 'sh.start' (and the barrier does not exist yet):
+static void stopSweepWorkers(SweepShared& sh, vec<SweepWorker*>& workers, int n_started, bool running)
+{
+    sh.quit = true;
+    if (running)
+        pthread_barrier_wait(&sh.barrier);
+    else
+        pthread_mutex_unlock(&sh.start);
+    for (int i = 1; i <= n_started; i++)
+        pthread_join(workers[i]->thread, NULL);
+    if (running)
+        pthread_barrier_destroy(&sh.barrier);
+    pthread_mutex_destroy(&sh.start);
+
+    for (int i = 0; i < workers.size(); i++){
+        pthread_mutex_destroy(&sh.queues[i].lock);
+        delete workers[i];
+    }
+    delete [] sh.queues;
+}
+
+
+int Minisat::satSweepParallel(Circ& cin, const Eqs& eqs_in, Eqs& eqs_out, int n_threads, int verbosity,
+                              const SweepBudget& budget, SweepCallback callback, void* callback_data)
+{
+    assert(n_threads >= 1);
+    eqs_out.clear();
+
+    // Make sure that all gates referred to in some equivalence get a variable of their own:
+    for (int i = 0; i < eqs_in.size(); i++)
+        for (int j = 0; j < eqs_in[i].size(); j++)
+            cin.bumpFanout(gate(eqs_in[i][j]));
+
+    Eqs tasks, proven, undecided;
+    for (int i = 0; i < eqs_in.size(); i++)
+        addSweepTasks(eqs_in[i], tasks, proven);
+
+    SweepBudget b = budget;
+    SweepShared sh;
+    sh.circ      = &cin;
+    sh.tasks     = &tasks;
+    sh.proven    = &proven;
+    sh.budget    = &b;
+    sh.deadline  = budget.time_budget < 0 ? -1 : sweepRealTime() + budget.time_budget;
+    sh.n_workers = n_threads;
+    sh.queues    = new SweepQueue[n_threads];
+    sh.quit      = false;
+    vec<SweepWorker*> workers;
+    for (int i = 0; i < n_threads; i++){
+        pthread_mutex_init(&sh.queues[i].lock, NULL);
+        workers.push(new SweepWorker(cin));
+        workers[i]->shared = &sh;
+        workers[i]->id     = i;
+    }
+
+    // Start the worker threads:
+    pthread_mutex_init(&sh.start, NULL);
+    pthread_mutex_lock(&sh.start);
+    for (int i = 1; i < n_threads; i++)
+        if (pthread_create(&workers[i]->thread, NULL, sweepWorkerMain, workers[i]) != 0){
+            stopSweepWorkers(sh, workers, i - 1, false);
+            return -1; }
+    pthread_barrier_init(&sh.barrier, NULL, n_threads);
+    pthread_mutex_unlock(&sh.start);
+
+    if (verbosity >= 1){
+        printf("===========================[ Parallel SAT Sweeping ]==========================\n");
+        printf("| ROUND |   TASKS   PROVEN   FAILED |  CANDIDATES |   SOLVES  |     TIME     |\n");
+        printf("==============================================================================\n"); }
+
+    double     time   = sweepRealTime();
+    int        rounds = 0;
+    SweepStats st;
+    ClassHeap  order;
+    vec<int>   sorted;
+    while (tasks.size() > 0){
+        rounds++;
+
+        // Hand out tasks, closest to the inputs first, round-robin over the workers (each worker
+        // takes from the back of its queue):
+        order.clear();
+        for (int i = 0; i < tasks.size(); i++){
+            GateWord min_index = index(gate(tasks[i].last()));
+            for (int j = 0; j < tasks[i].size(); j++)
+                if (tasks[i][j] != sig_True && index(gate(tasks[i][j])) < min_index)
+                    min_index = index(gate(tasks[i][j]));
+            order.push(min_index, i);
+        }
+        sorted.clear();
+        for (; order.size() > 0; order.pop())
+            sorted.push(order.top());
+        for (int i = 0; i < n_threads; i++){
+            sh.queues[i].tasks.clear();
+            sh.queues[i].head = 0; }
+        for (int i = sorted.size()-1; i >= 0; i--)
+            sh.queues[i % n_threads].tasks.push(sorted[i]);
+        sh.result.clear();
+        sh.result.growTo(tasks.size(), task_Proven);
+        sh.members.clear();
+        sh.members.growTo(tasks.size());
+
+        pthread_barrier_wait(&sh.barrier);
+        sweepRound(*workers[0]);
+        pthread_barrier_wait(&sh.barrier);
+
+        for (int i = 0; i < n_threads; i++)
+            addSweepStats(st, workers[i]->stats);
+
+        // Collect proven and undecided tasks, and failed classes together with the failed units. A
+        // partial task is split into its proven part, its undecided part (both with the
+        // representative), and the members split off by counterexamples:
+        double   refine_time = sweepRealTime();
+        Eqs      failed;
+        vec<Sig> failed_units, sub, rest, out;
+        int      n_proven = 0, n_failed = 0;
+        for (int i = 0; i < tasks.size(); i++)
+            if (sh.result[i] == task_Proven){
+                n_proven++;
+                proven.push();
+                tasks[i].copyTo(proven.last());
+            }else if (sh.result[i] == task_Undecided){
+                undecided.push();
+                tasks[i].copyTo(undecided.last());
+            }else if (sh.result[i] == task_Partial){
+                sub .clear();
+                rest.clear();
+                out .clear();
+                sub .push(tasks[i][0]);
+                rest.push(tasks[i][0]);
+                for (int j = 1; j < tasks[i].size(); j++)
+                    if      (sh.members[i][j] == task_Proven) sub .push(tasks[i][j]);
+                    else if (sh.members[i][j] == task_Failed) out .push(tasks[i][j]);
+                    else                                      rest.push(tasks[i][j]);
+                if (sub[0] != sig_True || sub.size() > 1){
+                    proven.push();
+                    sub.copyTo(proven.last()); }
+                if (rest.size() > 1){
+                    undecided.push();
+                    rest.copyTo(undecided.last()); }
+                if (out.size() > 0){
+                    n_failed++;
+                    if (tasks[i][0] == sig_True)
+                        failed_units.push(out[0]);
+                    else{
+                        failed.push();
+                        out.copyTo(failed.last()); }
+                }
+            }else{
+                n_failed++;
+                if (tasks[i][0] == sig_True)
+                    failed_units.push(tasks[i][1]);
+                else{
+                    failed.push();
+                    tasks[i].copyTo(failed.last());
+                }
+            }
+        if (failed_units.size() > 0){
+            failed.push();
+            failed_units.copyTo(failed.last());
+        }
+
+        // Split failed classes with all counterexamples, 512 at a time:
+        int n_cex = 0;
+        for (int i = 0; i < n_threads; i++)
+            n_cex += workers[i]->cex_task.size();
+        for (int first = 0; first < n_cex; first += 512){
+            int     n_words = ((n_cex - first < 512 ? n_cex - first : 512) + 63) / 64;
+            CircSim sim(cin, n_words);
+            sim.randomizeInputs();
+            for (int i = 0, k = 0; i < n_threads; i++){
+                const SweepWorker& w = *workers[i];
+                for (int c = 0; c < w.cex_task.size(); c++, k++)
+                    if (k >= first && k < first + 512){
+                        int j = 0;
+                        for (InpIt iit = cin.inpBegin(); iit != cin.inpEnd(); ++iit, j++){
+                            lbool v = w.cex_inps[c * cin.nInps() + j];
+                            if (v != l_Undef)
+                                sim.setPattern(*iit, k - first, v == l_True);
+                        }
+                    }
+            }
+            sim.simulate();
+
+            Eqs split;
+            splitBySim(sim, failed, split);
+            split.moveTo(failed);
+        }
+
+        // Next round (undecided tasks are retried with larger budgets when nothing else is left):
+        bool timed_out = sh.deadline >= 0 && sweepRealTime() > sh.deadline;
+        tasks.clear();
+        if (!timed_out)
+            for (int i = 0; i < failed.size(); i++)
+                addSweepTasks(failed[i], tasks, proven);
+        st.refine_time   = sweepRealTime() - refine_time;
+        st.classes_split = n_failed;
+
+        int n_units, n_classes;
+        if (tasks.size() == 0 && undecided.size() > 0 && !timed_out && b.escalate > 1){
+            countTasks(undecided, n_units, n_classes);
+            escalateBudget(b, n_units, n_classes, verbosity);
+            undecided.moveTo(tasks);
+        }
+
+        if (verbosity >= 1){
+            uint64_t solves = 0;
+            for (int i = 0; i < n_threads; i++)
+                solves += workers[i]->solver.solves;
+            printf("| %5d | %8d %8d %8d | %11d | %9d | %10.2f s |\n",
+                   rounds, sh.result.size(), n_proven, n_failed, tasks.size(), (int)solves, sweepRealTime() - time);
+        }
+
+        if (callback != NULL){
+            st.round = rounds;
+            st.final = tasks.size() == 0;
+            countTasks(tasks,  st.cand_units,   st.cand_classes);
+            countTasks(proven, st.proven_units, st.proven_classes);
+            st.mem_used = memUsed();
+            callback(st, callback_data);
+        }
+        st.clear();
+
+        if (timed_out){
+            if (verbosity >= 1) printf("| Time budget exhausted.\n");
+            break; }
+    }
+
+    if (verbosity >= 1 && undecided.size() > 0){
+        int n_units, n_classes;
+        countTasks(undecided, n_units, n_classes);
+        printf("| Undecided: %d units, %d classes (dropped)\n", n_units, n_classes);
+    }
+
+    // Return proven classes as 'satSweep()' does, with all units in one class and the parts of a
+    // class that were proven in different rounds merged:
+    EqsWithUnits result;
+    for (int i = 0; i < proven.size(); i++)
+        if (proven[i][0] == sig_True){
+            for (int j = 1; j < proven[i].size(); j++)
+                result.addUnit(proven[i][j]);
+        }else
+            result.addClass(proven[i]);
+    result.toEqs(eqs_out);
+
+    stopSweepWorkers(sh, workers, n_threads - 1, true);
+
+    if (verbosity >= 1)
+        printf("==============================================================================\n");
+    return rounds;
+}
+
+
+//=================================================================================================
+// FRAIG-style sweeping:
+//
+//   Gates are copied in topological order. Every class of candidates gets a representative, which
+//   is its first copied member (the class of units has 'sig_True'). When a later member has been
+//   copied, it is checked against the copy of the representative, and if they are equivalent the
+//   member is replaced by the representative in the rest of the copy. The classes are first split
+//   by 64 random patterns. A counterexample moves the member to a class of its own for this batch
+//   (shared with the other members of its class that fail in the same batch), and is stored as a
+//   pattern. When 64 patterns have been collected, they are simulated at once and the classes of
+//   the candidates that are not decided yet are split by them.
+
+struct FraigKey { int root; uint64_t word; int pos; };
+struct FraigKeyLt { bool operator()(const FraigKey& a, const FraigKey& b) const {
+    return a.root < b.root || (a.root == b.root && (a.word < b.word || (a.word == b.word && a.pos < b.pos))); } };
+
+// Split the classes of the candidates 'cands[from..]' (the ones not copied yet) by their words in
+// 'sim'. A class and the classes that its failed members were moved to in this batch ('split_to',
+// followed transitively) form a family, which is split as a whole: members with the same word as
+// the representative of a family class go to that class, and every remaining word gets a new
+// class. A class without a representative has no family, and keeps the members with the same word
+// as its first member:
+static void fraigSplit(const CircSim& sim, const vec<Gate>& cands, int from, const vec<int>& split_to, GMap<int>& cls,
+                       const GMap<char>& pol, vec<Sig>& rep_src, vec<Sig>& rep_copy)
+{
+    vec<int> root(rep_src.size());
+    for (int c = 0; c < root.size(); c++)
+        root[c] = c;
+    for (int c = 0; c < split_to.size(); c++)
+        if (split_to[c] >= 0){
+            assert(split_to[c] > c);
+            root[split_to[c]] = root[c]; }
+
+    vec<FraigKey> keys;
+    vec<uint64_t> first(rep_src.size(), 0);
+    vec<char>     has_first(rep_src.size(), 0);
+    for (int i = from; i < cands.size(); i++){
+        Gate g = cands[i];
+        int  c = cls[g];
+        if (c < 0) continue;
+
+        FraigKey k; k.root = root[c]; k.word = sim.word(mkSig(g, pol[g]), 0); k.pos = i;
+        keys.push(k);
+        if (!has_first[c]){
+            first[c]     = k.word;
+            has_first[c] = 1; }
+    }
+    sort(keys, FraigKeyLt());
+
+    vec<int>      fam;
+    vec<uint64_t> fam_ref;
+    for (int i = 0, j; i < keys.size(); i = j){
+        int r = keys[i].root;
+        if (i == 0 || keys[i-1].root != r){
+            fam.clear();
+            fam_ref.clear();
+            for (int d = r; d >= 0; d = d < split_to.size() ? split_to[d] : -1){
+                assert(d == r || rep_src[d] != sig_Undef);
+                fam.push(d);
+                fam_ref.push(rep_src[d] != sig_Undef ? sim.word(rep_src[d], 0) : first[d]);
+            }
+        }
+
+        int to = -1;
+        for (int f = 0; to < 0 && f < fam.size(); f++)
+            if (fam_ref[f] == keys[i].word)
+                to = fam[f];
+        if (to < 0){
+            to = rep_src.size();
+            rep_src .push(sig_Undef);
+            rep_copy.push(sig_Undef); }
+        for (j = i; j < keys.size() && keys[j].root == r && keys[j].word == keys[i].word; j++)
+            cls[cands[keys[j].pos]] = to;
+    }
+}
+
+
+void Minisat::satSweepFraig(const Circ& src, const Eqs& cands, Circ& dst, GMap<Sig>& copy_map, Equivs& proven,
+                            int verbosity, const SweepBudget& budget)
+{
+    // Give every candidate gate its class and polarity. Class 0 is the class of units:
+    GMap<int>  cls; cls.growTo(src.lastGate(), -1);
+    GMap<char> pol; pol.growTo(src.lastGate(), 0);
+    vec<Sig>   rep_src;
+    vec<Sig>   rep_copy;
+    rep_src .push(sig_True);
+    rep_copy.push(sig_True);
+    for (int i = 0; i < cands.size(); i++){
+        int c = find(cands[i], sig_True) ? 0 : rep_src.size();
+        if (c != 0){
+            rep_src .push(sig_Undef);
+            rep_copy.push(sig_Undef); }
+        for (int j = 0; j < cands[i].size(); j++)
+            if (cands[i][j] != sig_True){
+                cls[gate(cands[i][j])] = c;
+                pol[gate(cands[i][j])] = sign(cands[i][j]);
+            }
+    }
+
+    // The candidates in the order they are copied:
+    vec<Gate> cand_gates;
+    for (GateIt git = src.begin(); git != src.end(); ++git)
+        if (cls[*git] >= 0)
+            cand_gates.push(*git);
+
+    // Split the classes by random patterns first:
+    vec<int> split_to;                            // Class of the members that failed in this batch.
+    CircSim  sim(src, 1);
+    sim.randomizeInputs();
+    sim.simulate();
+    fraigSplit(sim, cand_gates, 0, split_to, cls, pol, rep_src, rep_copy);
+
+    Solver             s;
+    Clausifyer<Solver> cl(dst, s);
+    double             seed     = 91648253;
+    double             deadline = budget.time_budget < 0 ? -1 : cpuTime() + budget.time_budget;
+    int                k        = 0;              // Number of counterexamples in 'sim'.
+    int                next     = 0;              // Position in 'cand_gates'.
+    int                n_merged = 0, n_cex = 0, n_undec = 0;
+
+    dst.clear();
+    proven.clear();
+    copy_map.clear();
+    copy_map.growTo(src.lastGate(), sig_Undef);
+    copy_map[gate_True] = sig_True;
+    for (GateIt git = src.begin(); git != src.end(); ++git){
+        Gate g = *git;
+        if (type(g) == gtype_Inp)
+            copy_map[g] = dst.mkInp(src.number(g));
+        else{
+            Sig x = src.lchild(g);
+            Sig y = src.rchild(g);
+            copy_map[g] = dst.mkAnd(copy_map[gate(x)] ^ sign(x), copy_map[gate(y)] ^ sign(y));
+        }
+        if (cls[g] < 0)
+            continue;
+
+        assert(cand_gates[next] == g);
+        next++;
+
+        for (;;){
+            int c = cls[g];
+            Sig x = mkSig(g, pol[g]);
+            Sig x_copy = copy_map[g] ^ pol[g];
+            if (rep_src[c] == sig_Undef){
+                // First member of the class, make it the representative:
+                rep_src [c] = x;
+                rep_copy[c] = x_copy;
+                break;
+            }else if (x_copy == rep_copy[c]){
+                // Already merged structurally:
+                proven.merge(rep_src[c], x);
+                break;
+            }else if (k == 64){
+                // A full batch of counterexamples, split the candidates from 'g' and on by it. Every
+                // class in 'split_to' has a representative at this point:
+                sim.simulate();
+                fraigSplit(sim, cand_gates, next-1, split_to, cls, pol, rep_src, rep_copy);
+                split_to.clear();
+                k = 0;
+                continue;
+            }else if (timedOut(deadline))
+                break;
+
+            Lit   p   = cl.clausify(x_copy);
+            Lit   q   = cl.clausify(rep_copy[c]);
+            lbool res = solveBudget(s, budget, p, ~q);
+            if (res == l_False)
+                res = solveBudget(s, budget, ~p, q);
+
+            if (res == l_False){
+                // Proven, replace 'g' by the representative:
+                copy_map[g] = rep_copy[c] ^ pol[g];
+                proven.merge(rep_src[c], x);
+                n_merged++;
+                break;
+            }else if (res == l_Undef){
+                n_undec++;
+                break;
+            }
+
+            // Store the counterexample as pattern 'k'. The model shows that 'g' differs from the
+            // representative, so it moves to the class of this batch's failures from 'c' and is
+            // tried against that class instead:
+            n_cex++;
+            for (InpIt iit = src.inpBegin(); iit != src.inpEnd(); ++iit){
+                lbool v = cl.modelValue(copy_map[*iit]);
+                sim.setPattern(*iit, k, v == l_Undef ? irand(seed, 2) : v == l_True);
+            }
+            k++;
+            split_to.growTo(rep_src.size(), -1);
+            if (split_to[c] == -1){
+                split_to[c] = rep_src.size();
+                rep_src .push(sig_Undef);
+                rep_copy.push(sig_Undef); }
+            cls[g] = split_to[c];
+        }
+    }
+
+    if (verbosity >= 1)
+        printf("| FRAIG: %"PRIgs" gates => %"PRIgs" gates, %d merged, %d counterexamples, %d undecided, %d solves\n",
+               src.nGates(), dst.nGates(), n_merged, n_cex, n_undec, (int)s.solves);
+}
+
+
+//=================================================================================================
+// Windowed sweeping:
+//
+//   The window of a query is copied into a small circuit of its own, where every gate outside
+//   the window (including the primary inputs) is represented by an input of its own. These
+//   inputs are shared by all windows, so overlapping windows are shared through structural
+//   hashing in the window circuit, and thus also in the solver.
+
+struct SweepWin {
+    Circ               c;
+    Solver             s;
+    Clausifyer<Solver> cl;
+    GMap<Sig>          cut_map;       // Input of the window circuit for each gate of the source.
+
+    SweepWin() : cl(c, s) {}
+};
+
+
+// Collect the And-gates of the fan-in of 'x' and 'y' that are less than 'depth' levels below
+// them (at most 'max_size' gates), in topological order. Returns true if all the fan-in down to
+// the primary inputs was collected:
+static bool collectWindow(const Circ& cin, Sig x, Sig y, int depth, GateSize max_size, GSet& inside, vec<Gate>& gates)
+{
+    vec<Gate> curr, next;
+    inside.clear();
+    if (type(gate(x)) == gtype_And){ inside.insert(gate(x)); curr.push(gate(x)); }
+    if (type(gate(y)) == gtype_And){ inside.insert(gate(y)); curr.push(gate(y)); }
+
+    for (int d = 1; d < depth && curr.size() > 0; d++){
+        next.clear();
+        for (int i = 0; i < curr.size(); i++){
+            Gate l = gate(cin.lchild(curr[i]));
+            Gate r = gate(cin.rchild(curr[i]));
+            if (type(l) == gtype_And && !inside.has(l) && (GateSize)inside.size() < max_size){ inside.insert(l); next.push(l); }
+            if (type(r) == gtype_And && !inside.has(r) && (GateSize)inside.size() < max_size){ inside.insert(r); next.push(r); }
+        }
+        next.moveTo(curr);
+    }
+
+    gates.clear();
+    bool complete = true;
+    for (int i = 0; i < inside.size(); i++){
+        Gate g = inside[i];
+        gates.push(g);
+        if ((type(gate(cin.lchild(g))) == gtype_And && !inside.has(gate(cin.lchild(g)))) ||
+            (type(gate(cin.rchild(g))) == gtype_And && !inside.has(gate(cin.rchild(g)))))
+            complete = false;
+    }
+    sort(gates);
+
+    return complete;
+}
+
+
+static Sig windowSig(SweepWin& w, const GSet& inside, const GMap<Sig>& local, Sig x)
+{
+    Gate g = gate(x);
+    if (g == gate_True)
+        return x;
+    else if (inside.has(g))
+        return local[g] ^ sign(x);
+
+    w.cut_map.growTo(g, sig_Undef);
+    if (w.cut_map[g] == sig_Undef)
+        w.cut_map[g] = w.c.mkInp();
+    return w.cut_map[g] ^ sign(x);
+}
+
+
+// Check the counterexample of the last query of 'w' by evaluating the fan-in cones of 'x' and 'y'
+// (inputs outside the window get random values), and store it as pattern 'k' of 'pats'. Returns
+// true if 'x' and 'y' differ under it:
+static bool windowCex(const Circ& cin, SweepWin& w, Sig x, Sig y, int k, double& seed,
+                      GMap<uint64_t>& pats, GSet& cone, GMap<lbool>& values)
+{
+    for (InpIt iit = cin.inpBegin(); iit != cin.inpEnd(); ++iit)
+        pats[*iit] = (pats[*iit] & ~((uint64_t)1 << k)) | ((uint64_t)irand(seed, 2) << k);
+
+    cone.clear();
+    bottomUpOrder(cin, gate(x), cone);
+    bottomUpOrder(cin, gate(y), cone);
+    for (int i = 0; i < cone.size(); i++){
+        Gate g = cone[i];
+        if (type(g) != gtype_Inp) continue;
+
+        lbool v = w.cut_map.has(g) && w.cut_map[g] != sig_Undef ? w.cl.modelValue(w.cut_map[g]) : l_Undef;
+        if (v != l_Undef)
+            pats[g] = (pats[g] & ~((uint64_t)1 << k)) | ((uint64_t)(v == l_True) << k);
+        values[g] = lbool((bool)((pats[g] >> k) & 1));
+    }
+
+    bool differ = evaluate(cin, x, values) != evaluate(cin, y, values);
+    for (int i = 0; i < cone.size(); i++)
+        values[cone[i]] = l_Undef;
+    return differ;
+}
+
+
+// Check the recycling limits of 'win' before query number 'n_queries' (the limits of 'b' only every
+// 64 queries). Returns true if the window solver should be recycled:
+static bool windowNeedsRecycling(const SweepWin& w, const SweepWindow& win, const SweepBudget& b, uint64_t n_queries)
+{
+    if ((uint64_t)w.s.nClauses() + w.s.nLearnts() > win.recycle_clauses || w.c.nGates() > win.recycle_gates)
+        return true;
+    if (n_queries % 64 != 0)
+        return false;
+    return needsRecycling(w.s, b);
+}
+
+
+int Minisat::satSweepWindowed(const Circ& cin, const Eqs& eqs_in, Eqs& eqs_out, const SweepWindow& win, int verbosity, const SweepBudget& budget)
+{
+    // Simulation of the source with random patterns. Counterexamples are checked on the cones of
+    // the query only, and are collected in 'pats' until there are 64 of them, which then replace
+    // the patterns of the simulation:
+    CircSim sim(cin, 1);
+    sim.randomizeInputs();
+    sim.simulate();
+
+    GMap<uint64_t> pats;   pats  .growTo(cin.lastGate(), 0);
+    GMap<lbool>    values; values.growTo(cin.lastGate(), l_Undef);
+    GSet           cone;
+    values[gate_True] = l_True;
+
+    SweepBudget b        = budget;
+    double      seed     = 91648253;
+    double      deadline = budget.time_budget < 0 ? -1 : cpuTime() + budget.time_budget;
+    int         k        = 0;
+    int         n_cex = 0, n_spurious = 0, n_proven = 0, n_undec = 0, n_limited = 0, n_recycled = 0;
+    uint64_t    n_queries = 0;
+
+    // Work list of classes, each with its representative (the constant, or its smallest gate) first:
+    Eqs work;
+    for (int i = 0; i < eqs_in.size(); i++){
+        work.push();
+        eqs_in[i].copyTo(work.last());
+        sort(work.last());
+    }
+
+    SweepWin*  w = new SweepWin;
+    GSet       inside;
+    vec<Gate>  gates;
+    GMap<Sig>  local;
+    local.growTo(cin.lastGate(), sig_Undef);
+
+    // A class may be tried several times (after undecided queries), and the units from all classes
+    // with the constant as representative, so the proofs are merged before they are returned:
+    Equivs   proven;
+    Eqs      undecided;   // Classes of the undecided candidates, each with its representative first.
+    vec<Sig> rest, undec;
+    for (;;){
+        if (work.size() == 0 || timedOut(deadline)){
+            // Out of time, the classes not tried yet are undecided as well:
+            for (int i = 0; i < work.size(); i++){
+                undecided.push();
+                work[i].moveTo(undecided.last()); }
+            work.clear();
+
+            // Try the undecided candidates again with larger budgets, as in 'satSweep()' (larger
+            // budgets do not help the ones whose window is already as large as allowed):
+            int n_units = 0, n_classes = 0;
+            n_undec = n_limited;
+            for (int i = 0; i < undecided.size(); i++){
+                if (undecided[i][0] == sig_True) n_units += undecided[i].size() - 1;
+                else                             n_classes++;
+                n_undec += undecided[i].size() - 1; }
+            if (timedOut(deadline) || undecided.size() == 0 || b.escalate <= 1)
+                break;
+
+            escalateBudget(b, n_units, n_classes, verbosity);
+            for (int i = 0; i < undecided.size(); i++){
+                work.push();
+                undecided[i].moveTo(work.last()); }
+            undecided.clear();
+            continue;
+        }
+
+        Sig rep = work.last()[0];
+        rest .clear();
+        undec.clear();
+        for (int j = 1; j < work.last().size(); j++){
+            Sig   x       = work.last()[j];
+            lbool res     = l_Undef;
+            bool  limited = false;   // Undecided because the window can not grow.
+
+            if (sim.word(x, 0) != sim.word(rep, 0))
+                // Already refuted by some pattern:
+                res = l_True;
+            else
+                for (int depth = win.depth; !timedOut(deadline); depth *= 2){
+                    if (windowNeedsRecycling(*w, win, b, n_queries++)){
+                        delete w;
+                        w = new SweepWin;
+                        n_recycled++; }
+
+                    // Copy the window to the window circuit and solve:
+                    bool complete = collectWindow(cin, rep, x, depth, win.max_size, inside, gates);
+                    for (int i = 0; i < gates.size(); i++){
+                        Gate g  = gates[i];
+                        local[g] = w->c.mkAnd(windowSig(*w, inside, local, cin.lchild(g)), windowSig(*w, inside, local, cin.rchild(g)));
+                    }
+                    Lit p = w->cl.clausify(windowSig(*w, inside, local, rep));
+                    Lit q = w->cl.clausify(windowSig(*w, inside, local, x));
+                    for (int i = 0; i < gates.size(); i++)
+                        local[gates[i]] = sig_Undef;
+
+                    res = solveBudget(w->s, b, p, ~q);
+                    if (res == l_False)
+                        res = solveBudget(w->s, b, ~p, q);
+                    if (res != l_True)
+                        break;
+
+                    if (windowCex(cin, *w, x, rep, k, seed, pats, cone, values)){
+                        // A real counterexample, simulate once 64 of them have been collected:
+                        n_cex++;
+                        if (++k == 64){
+                            for (InpIt iit = cin.inpBegin(); iit != cin.inpEnd(); ++iit)
+                                sim.setInput(*iit, 0, pats[*iit]);
+                            sim.simulate();
+                            k = 0;
+                        }
+                        break; }
+
+                    // Spurious, expand the window if possible:
+                    n_spurious++;
+                    res = l_Undef;
+                    if (complete || depth >= win.max_depth || (GateSize)gates.size() >= win.max_size){
+                        limited = true;
+                        break; }
+                }
+
+            if      (res == l_False){ proven.merge(rep, x); n_proven++; }
+            else if (res == l_True)   rest.push(x);
+            else if (limited)         n_limited++;
+            else                      undec.push(x);
+        }
+
+        work.pop();
+        if (rest.size() > 1){
+            work.push();
+            rest.copyTo(work.last()); }
+        if (undec.size() > 0){
+            undecided.push();
+            undecided.last().push(rep);
+            for (int j = 0; j < undec.size(); j++)
+                undecided.last().push(undec[j]);
+        }
+    }
+    delete w;
+
+    eqs_out.clear();
+    for (uint32_t i = 0; i < proven.size(); i++){
+        eqs_out.push();
+        proven[i].copyTo(eqs_out.last());
+        sort(eqs_out.last());
+    }
+
+    if (verbosity >= 1)
+        printf("| WINDOWED SWEEP: %d proven, %d counterexamples, %d spurious, %d undecided (%d with a full window), %d solver(s)\n",
+               n_proven, n_cex, n_spurious, n_undec, n_limited, n_recycled + 1);
+
+    return n_cex;
+}
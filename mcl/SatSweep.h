@@ -26,13 +26,126 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "mcl/CircPrelude.h"
 #include "mcl/Clausify.h"
 #include "mcl/DagShrink.h"
+#include "mcl/Equivs.h"
 
 namespace Minisat {
 
-int  satSweep(Circ& cin, Clausifyer<Solver>& cl, Solver& s, const Eqs& eqs_in, Eqs& eqs_out, int verbosity = 1);
-int  satSweep(Circ& cin, Clausifyer<SimpSolver>& cl, SimpSolver& s, const Eqs& eqs_in, Eqs& eqs_out, int verbosity = 1);
+//=================================================================================================
+// Resource limits for 'satSweep()':
+//
+// Each equivalence query is given at most 'conf_budget' conflicts and 'prop_budget' propagations
+// (negative means no limit). Queries that run out are left undecided; when everything else is done
+// the undecided candidates are tried again with the budgets multiplied by 'escalate' (if
+// 'escalate' is not greater than 1, undecided candidates are simply dropped). When 'time_budget'
+// seconds of cpu time have passed, the sweep stops and returns what has been proven so far. The
+// time is only checked between queries, so it should be combined with a conflict budget.
+//
+// The 'SimpSolver' version of 'satSweep()' replaces its solver with a fresh one when it has more
+// than 'recycle_clauses' clauses (original and learnt), or when the process uses more than
+// 'recycle_mem' megabytes (negative means never). The limits are checked every 64 queries, and
+// whenever the candidates are refined or retried. The fresh solver only gets the cones of the
+// remaining candidates, together with the equivalences proven so far as binary clauses. The
+// solver and clausifyer given by the caller are left as they were at the first recycling.
+
+struct SweepBudget {
+    int64_t conf_budget;
+    int64_t prop_budget;
+    double  escalate;
+    double  time_budget;
+    int64_t recycle_clauses;
+    double  recycle_mem;
+
+    SweepBudget() : conf_budget(-1), prop_budget(-1), escalate(2), time_budget(-1), recycle_clauses(-1), recycle_mem(-1) {}
+};
+
+//=================================================================================================
+// Statistics of one round of 'satSweep()' (up to 64 counterexamples and the refinement they cause,
+// or the final proofs). Query counts, histograms and times only cover the round; the candidate and
+// proven counts are the state after it. Time is cpu time in seconds.
+
+struct SweepStats {
+    enum { n_hist = 8 };
+
+    int      round;
+    bool     final;
+
+    uint64_t sat_queries;
+    uint64_t unsat_queries;
+    uint64_t undecided_queries;
+    uint64_t time_hist[n_hist];   // Queries taking < 1us, < 10us, ..., < 1s, and the rest.
+    uint64_t conf_hist[n_hist];   // Queries with 0, < 10, < 100, ..., < 1000000 conflicts, and the rest.
+
+    double   clausify_time;
+    double   solve_time;
+    double   refine_time;
+    double   simp_time;           // Variable elimination and solver recycling ('SimpSolver' only).
+    int      classes_split;       // Classes (including the units) split by the counterexamples.
+    int      recycles;            // Solvers replaced by a fresh one ('SimpSolver' only).
+
+    int      cand_units, cand_classes;
+    int      proven_units, proven_classes;
+    double   mem_used;            // Megabytes.
+
+    SweepStats() : round(0), final(false) { clear(); }
+
+    void clear();                 // Clear everything that is counted per round.
+    void addQuery(lbool res, double time, uint64_t conflicts);
+};
+
+// Called after each round of 'satSweep()' with the statistics of the round:
+typedef void (*SweepCallback)(const SweepStats& stats, void* data);
+
+// A 'SweepCallback' that writes the statistics as one line of JSON to the 'FILE*' in 'data':
+void printSweepStatsJson(const SweepStats& stats, void* data);
+
+int  satSweep(Circ& cin, Clausifyer<Solver>& cl, Solver& s, const Eqs& eqs_in, Eqs& eqs_out, int verbosity = 1,
+              const SweepBudget& budget = SweepBudget(), SweepCallback callback = NULL, void* callback_data = NULL);
+int  satSweep(Circ& cin, Clausifyer<SimpSolver>& cl, SimpSolver& s, const Eqs& eqs_in, Eqs& eqs_out, int verbosity = 1,
+              const SweepBudget& budget = SweepBudget(), SweepCallback callback = NULL, void* callback_data = NULL);
+
+// Prove the candidate classes 'eqs_in' with 'n_threads' workers, each with a solver of its own.
+// The budgets are used as in 'satSweep()', except that 'time_budget' is measured in real time and
+// the callback is called once per round. Returns the number of rounds, or -1 if the worker threads
+// could not be created:
+int  satSweepParallel(Circ& cin, const Eqs& eqs_in, Eqs& eqs_out, int n_threads, int verbosity = 1,
+                      const SweepBudget& budget = SweepBudget(), SweepCallback callback = NULL, void* callback_data = NULL);
+
+// Windowed sweeping: each query only clausifies a window of the fan-in of the two gates, at most
+// 'depth' levels deep and with at most 'max_size' gates. Gates just outside the window become
+// free variables. A counterexample is checked by evaluating the fan-in of the two gates; if it is
+// spurious the depth of the window is doubled (up to 'max_depth'), and if the window can not grow
+// the candidate is left undecided for good. The window solver and circuit are replaced by fresh
+// ones when the solver has more than 'recycle_clauses' clauses (original and learnt), when the
+// window circuit has more than 'recycle_gates' gates, or when the limits of the 'SweepBudget' are
+// reached (checked every 64 queries).
+
+struct SweepWindow {
+    int      depth;
+    int      max_depth;
+    GateSize max_size;
+    uint64_t recycle_clauses;
+    GateSize recycle_gates;
+
+    SweepWindow() : depth(8), max_depth(1024), max_size(100000), recycle_clauses(1000000), recycle_gates(1000000) {}
+};
 
-void makeUnitClass(const Circ& cin, Eqs& unit);
+// Prove the candidate classes 'eqs_in' with windowed queries. Undecided candidates are tried
+// again with escalated budgets as in 'satSweep()', except those whose window could not grow. The
+// proven classes are returned in 'eqs_out', one per representative. Returns the number of
+// counterexamples found:
+int  satSweepWindowed(const Circ& cin, const Eqs& eqs_in, Eqs& eqs_out, const SweepWindow& win = SweepWindow(),
+                      int verbosity = 1, const SweepBudget& budget = SweepBudget());
+
+// FRAIG-style sweeping: copy 'src' to 'dst' in topological order while proving each candidate
+// of 'cands' against the representative (its first gate) of its class. Proven gates are replaced
+// by their representative immediately, so later queries are made over the already merged circuit.
+// The proven equivalences (over 'src') are returned in 'proven'. Copies of replaced gates are
+// left dangling in 'dst' (see 'Circ::compact()'):
+void satSweepFraig(const Circ& src, const Eqs& cands, Circ& dst, GMap<Sig>& copy_map, Equivs& proven,
+                   int verbosity = 1, const SweepBudget& budget = SweepBudget());
+
+void makeUnitClass (const Circ& cin, Eqs& unit);
+void makeSimClasses(const Circ& cin, Eqs& eqs, int n_words = 64);
 
 // NOTE: about to be deleted?
 #if 0
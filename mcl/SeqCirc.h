@@ -34,6 +34,7 @@ struct SeqCirc
     Circ  init;
     Flops flps;
 
+    // Iterate over the inputs of 'main' that are not flops (or those that are), in index order:
     class InpIt : public Circ::InpIt {
         const Flops& flps;
     protected:
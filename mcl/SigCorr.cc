@@ -0,0 +1,289 @@
+/**************************************************************************************[SigCorr.cc]
+Part of the Mini Circuit Library. See the file LICENSE for copyright and permission notice.
+**************************************************************************************************/
+
+#include "minisat/mtl/Sort.h"
+#include "minisat/utils/System.h"
+#include "minisat/core/Solver.h"
+#include "mcl/SigCorr.h"
+#include "mcl/Clausify.h"
+#include "mcl/CircPrelude.h"
+#include "mcl/SimKey.h"
+#include "mcl/Simulate.h"
+
+using namespace Minisat;
+
+//=================================================================================================
+// Helpers:
+//
+
+// Copy one frame of 'sc.main' to 'u', with the flops given by 'flop_vals' and fresh inputs for
+// the primary inputs. The copy of each gate is returned in 'frame':
+static void copyFrame(const SeqCirc& sc, Circ& u, const GMap<Sig>& flop_vals, GMap<Sig>& frame)
+{
+    frame.clear();
+    frame.growTo(sc.main.lastGate(), sig_Undef);
+    for (SeqCirc::FlopIt fit = sc.flpsBegin(); fit != sc.flpsEnd(); ++fit)
+        frame[*fit] = flop_vals[*fit];
+    for (SeqCirc::InpIt iit = sc.inpBegin(); iit != sc.inpEnd(); ++iit)
+        frame[*iit] = u.mkInp();
+    copyCirc(sc.main, u, frame);
+}
+
+
+// Candidate classes from sequential simulation. Each gate is taken in the polarity that is false
+// in the first pattern of the first frame, and classes are sorted with the smallest signal first:
+static void makeSeqClasses(const SeqCirc& sc, int sim_frames, int sim_words, Eqs& cands)
+{
+    SeqSim         sim(sc, sim_words);
+    GMap<uint64_t> sigs; sigs.growTo(sc.main.lastGate(), 0);
+    GMap<char>     pol;  pol .growTo(sc.main.lastGate(), 0);
+
+    for (int f = 0; f < sim_frames; f++){
+        sim.step();
+        const CircSim& vals = sim.values();
+        for (GateIt git = sc.main.begin(); git != sc.main.end(); ++git){
+            Gate g = *git;
+            if (f == 0) pol[g] = vals.phase(g);
+            sigs[g] = sigs[g] * 0x9e3779b97f4a7c15ULL ^ vals.hash(mkSig(g, pol[g]));
+        }
+        if (f == 0) pol[gate_True] = vals.phase(gate_True);
+        sigs[gate_True] = sigs[gate_True] * 0x9e3779b97f4a7c15ULL ^ vals.hash(mkSig(gate_True, pol[gate_True]));
+    }
+
+    // Bucket the flops, the and-gates and the constant by signature:
+    vec<SimKey> keys;
+    keys.push(mkSimKey(sigs[gate_True], mkSig(gate_True, pol[gate_True])));
+    for (GateIt git = sc.main.begin(); git != sc.main.end(); ++git)
+        if (type(*git) == gtype_And || sc.flps.isFlop(*git))
+            keys.push(mkSimKey(sigs[*git], mkSig(*git, pol[*git])));
+    sort(keys, SimKeyLt());
+
+    cands.clear();
+    for (int i = 0, j; i < keys.size(); i = j){
+        for (j = i + 1; j < keys.size() && keys[j].sig == keys[i].sig; j++)
+            ;
+        if (j - i > 1){
+            cands.push();
+            for (int l = i; l < j; l++)
+                cands.last().push(keys[l].x);
+        }
+    }
+}
+
+
+// Split all classes by the first 'n' patterns of 'sim', where the value of a member 'x' is the
+// value of 'frame[gate(x)] ^ sign(x)'. A class and the classes that its failed members were moved
+// to in this batch ('split_to', followed transitively) are split as a whole: each of them keeps its
+// members with the same values as its first member (in the same order, possibly leaving only one
+// member) and gets the members of the others with those values appended. The remaining members are
+// grouped by their values into new classes (smallest signal first), of which the trivial ones are
+// dropped:
+static int splitClasses(Eqs& cands, const CircSim& sim, int n, const GMap<Sig>& frame, const vec<int>& split_to)
+{
+    uint64_t      mask    = n == 64 ? ~(uint64_t)0 : ((uint64_t)1 << n) - 1;
+    int           n_split = 0;
+    int           n_cands = cands.size();
+    vec<char>     moved(n_cands, 0);
+    vec<int>      fam;
+    vec<uint64_t> ref;
+    vec<SimKey>   other;
+    for (int i = 0; i < split_to.size(); i++)
+        if (split_to[i] >= 0)
+            moved[split_to[i]] = 1;
+
+    for (int i = 0; i < n_cands; i++){
+        if (moved[i]) continue;
+
+        fam.clear();
+        ref.clear();
+        other.clear();
+        for (int c = i; c >= 0; c = c < split_to.size() ? split_to[c] : -1){
+            vec<Sig>& cls = cands[c];
+            fam.push(c);
+            ref.push(sim.word(frame[gate(cls[0])] ^ sign(cls[0]), 0) & mask);
+
+            int j, l;
+            for (j = l = 0; j < cls.size(); j++){
+                uint64_t w = sim.word(frame[gate(cls[j])] ^ sign(cls[j]), 0) & mask;
+                if (w == ref.last())
+                    cls[l++] = cls[j];
+                else
+                    other.push(mkSimKey(w, cls[j]));
+            }
+            cls.shrink(j - l);
+        }
+        if (other.size() == 0)
+            continue;
+
+        n_split++;
+        sort(other, SimKeyLt());
+        for (int m = 0, r; m < other.size(); m = r){
+            for (r = m + 1; r < other.size() && other[r].sig == other[m].sig; r++)
+                ;
+            int to = -1;
+            for (int f = 0; to < 0 && f < fam.size(); f++)
+                if (ref[f] == other[m].sig)
+                    to = fam[f];
+            if (to < 0 && r - m > 1){
+                to = cands.size();
+                cands.push(); }
+            if (to >= 0)
+                for (int t = m; t < r; t++)
+                    cands[to].push(other[t].x);
+        }
+    }
+
+    return n_split;
+}
+
+
+// Refine 'cands' until no member differs from the first member of its class in 'frame' (given the
+// assumptions 'assumps'). A member with a counterexample moves to the class of this batch's
+// failures from its class, and the counterexample is stored as a pattern of 'sim'. Once 64 of
+// them have been collected, they are simulated at once and all classes are split by them.
+// Returns the number of counterexamples:
+static int refineFrame(Solver& s, Clausifyer<Solver>& cl, const Circ& u, CircSim& sim, double& seed,
+                       const GMap<Sig>& frame, vec<Lit>& assumps, Eqs& cands)
+{
+    int      n_cex     = 0;
+    int      n_assumps = assumps.size();
+    int      k         = 0;   // Number of counterexamples in 'sim'.
+    vec<int> split_to;        // Class of the members that failed in this batch.
+    for (int i = 0; i < cands.size(); i++)
+        for (int j = 1; j < cands[i].size();){
+            Sig x = cands[i][0];
+            Sig y = cands[i][j];
+            Lit p = cl.clausify(frame[gate(x)] ^ sign(x));
+            Lit q = cl.clausify(frame[gate(y)] ^ sign(y));
+
+            bool sat = false;
+            for (int d = 0; !sat && d < 2; d++){
+                assumps.push(d ? ~p : p);
+                assumps.push(d ? q : ~q);
+                sat = s.solve(assumps);
+                assumps.shrink(assumps.size() - n_assumps);
+            }
+            if (!sat){
+                j++;
+                continue; }
+
+            // Store the counterexample (inputs without a variable get random values), and move 'y'
+            // out of class 'i':
+            n_cex++;
+            for (InpIt iit = u.inpBegin(); iit != u.inpEnd(); ++iit){
+                lbool v = cl.modelValue(*iit);
+                sim.setPattern(*iit, k, v == l_Undef ? drand(seed) < 0.5 : v == l_True);
+            }
+            k++;
+            split_to.growTo(i + 1, -1);
+            if (split_to[i] == -1){
+                split_to[i] = cands.size();
+                cands.push(); }
+            cands[split_to[i]].push(y);
+            cands[i][j] = cands[i].last();
+            cands[i].pop();
+
+            // A full batch, split all classes by it. The members before 'j' are proven equal to the
+            // first member, so they stay in place:
+            if (k == 64){
+                sim.simulate();
+                splitClasses(cands, sim, k, frame, split_to);
+                split_to.clear();
+                k = 0;
+            }
+        }
+
+    // Remove classes that became trivial:
+    int i, j;
+    for (i = j = 0; i < cands.size(); i++)
+        if (cands[i].size() > 1){
+            if (i != j) cands[i].moveTo(cands[j]);
+            j++; }
+    cands.shrink(i - j);
+
+    return n_cex;
+}
+
+
+//=================================================================================================
+// Signal correspondence:
+//
+
+int Minisat::sigCorr(const SeqCirc& sc, Equivs& eqs, int verbosity, int sim_frames, int sim_words)
+{
+    double time = cpuTime();
+
+    // Candidates:
+    Eqs cands;
+    makeSeqClasses(sc, sim_frames, sim_words, cands);
+    int n_cands = cands.size();
+
+    // Unrolling: the initial frame 'f0', and two consecutive frames 'f1' and 'f2' from a free state:
+    Circ      u;
+    GMap<Sig> init_map, flop_vals, f0, f1, f2;
+    for (InpIt iit = sc.init.inpBegin(); iit != sc.init.inpEnd(); ++iit){
+        init_map.growTo(*iit, sig_Undef);
+        init_map[*iit] = u.mkInp(); }
+    copyCirc(sc.init, u, init_map);
+
+    flop_vals.growTo(sc.main.lastGate(), sig_Undef);
+    for (SeqCirc::FlopIt fit = sc.flpsBegin(); fit != sc.flpsEnd(); ++fit){
+        Sig init = sc.flps.init(*fit);
+        flop_vals[*fit] = init_map[gate(init)] ^ sign(init);
+    }
+    copyFrame(sc, u, flop_vals, f0);
+
+    for (SeqCirc::FlopIt fit = sc.flpsBegin(); fit != sc.flpsEnd(); ++fit)
+        flop_vals[*fit] = u.mkInp();
+    copyFrame(sc, u, flop_vals, f1);
+
+    for (SeqCirc::FlopIt fit = sc.flpsBegin(); fit != sc.flpsEnd(); ++fit){
+        Sig next = sc.flps.next(*fit);
+        flop_vals[*fit] = f1[gate(next)] ^ sign(next);
+    }
+    copyFrame(sc, u, flop_vals, f2);
+
+    Solver             s;
+    Clausifyer<Solver> cl(u, s);
+    CircSim            sim(u, 1);
+    double             seed = 91648253;
+    vec<Lit>           assumps;
+
+    // Base case:
+    int n_base = refineFrame(s, cl, u, sim, seed, f0, assumps, cands);
+    if (verbosity >= 1)
+        printf("| SIGCORR: %d candidate classes, %d after %d initial state counterexamples\n", n_cands, cands.size(), n_base);
+
+    // Induction step; assume all classes in 'f1' (under a fresh activation literal) and check them
+    // in 'f2', until nothing is refined:
+    int iters = 0;
+    for (;;){
+        iters++;
+        Lit act = mkLit(s.newVar());
+        for (int i = 0; i < cands.size(); i++){
+            Lit p = cl.clausify(f1[gate(cands[i][0])] ^ sign(cands[i][0]));
+            for (int j = 1; j < cands[i].size(); j++){
+                Lit q = cl.clausify(f1[gate(cands[i][j])] ^ sign(cands[i][j]));
+                s.addClause(~act, ~p, q);
+                s.addClause(~act, p, ~q);
+            }
+        }
+        assumps.clear();
+        assumps.push(act);
+        int n_cex = refineFrame(s, cl, u, sim, seed, f2, assumps, cands);
+        s.addClause(~act);
+
+        if (verbosity >= 1)
+            printf("| SIGCORR: iteration %d, %d counterexamples, %d classes left (%.2f s)\n", iters, n_cex, cands.size(), cpuTime() - time);
+        if (n_cex == 0)
+            break;
+    }
+
+    eqs.clear();
+    for (int i = 0; i < cands.size(); i++)
+        for (int j = 1; j < cands[i].size(); j++)
+            eqs.merge(cands[i][0], cands[i][j]);
+
+    return iters;
+}
@@ -0,0 +1,30 @@
+/***************************************************************************************[SigCorr.h]
+Part of the Mini Circuit Library. See the file LICENSE for copyright and permission notice.
+**************************************************************************************************/
+
+#ifndef Minisat_SigCorr_h
+#define Minisat_SigCorr_h
+
+#include "mcl/SeqCirc.h"
+#include "mcl/Equivs.h"
+
+namespace Minisat {
+
+//=================================================================================================
+// Signal correspondence (van Eijk):
+//
+//   Finds equivalences between the flops and gates of 'SeqCirc::main' that hold in all reachable
+//   states. Candidate classes are taken from 'sim_frames' frames of random sequential simulation.
+//   They are first refined until they hold in the initial states, and then until they are
+//   inductive: if all classes hold in some state, they also hold in the next state. Both checks
+//   are done on an unrolling of 'main' (the initial frame, and two consecutive free frames).
+//   Returns the number of induction iterations, and the proven classes in 'eqs' (constant gates
+//   are equivalent to 'sig_True' or 'sig_False').
+
+int sigCorr(const SeqCirc& sc, Equivs& eqs, int verbosity = 1, int sim_frames = 32, int sim_words = 4);
+
+//=================================================================================================
+
+};
+
+#endif
@@ -0,0 +1,36 @@
+/****************************************************************************************[SimKey.h]
+Part of the Mini Circuit Library. See the file LICENSE for copyright and permission notice.
+**************************************************************************************************/
+
+#ifndef Minisat_SimKey_h
+#define Minisat_SimKey_h
+
+#include "mcl/CircTypes.h"
+
+namespace Minisat {
+
+//=================================================================================================
+// Helpers for splitting candidate classes by simulation (used by 'satSweep()' and 'sigCorr()'):
+
+// (stolen from Solver.h)
+static inline double drand(double& seed) {
+    seed *= 1389796;
+    int q = (int)(seed / 2147483647);
+    seed -= (double)q * 2147483647;
+    return seed / 2147483647; }
+
+// (stolen from Solver.h)
+static inline int irand(double& seed, int size) {
+    return (int)(drand(seed) * size); }
+
+// Signals sorted by a 64-bit key (a signature or a word of simulated values):
+struct SimKey { uint64_t sig; Sig x; };
+struct SimKeyLt { bool operator()(const SimKey& a, const SimKey& b) const { return a.sig < b.sig || (a.sig == b.sig && a.x < b.x); } };
+
+static inline SimKey mkSimKey(uint64_t sig, Sig x){ SimKey k; k.sig = sig; k.x = x; return k; }
+
+//=================================================================================================
+
+};
+
+#endif
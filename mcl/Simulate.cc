@@ -0,0 +1,650 @@
+/*************************************************************************************[Simulate.cc]
+Part of the Mini Circuit Library. See the file LICENSE for copyright and permission notice.
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcl/Simulate.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MCL_SIM_X86
+#include <immintrin.h>
+#endif
+
+using namespace Minisat;
+
+//=================================================================================================
+// Simulation kernels:
+//
+//   Each kernel evaluates a range of the schedule for the words 'w0 .. w1-1' of each gate. The words
+//   of a gate are contiguous, so the wide kernels simply handle 4 (AVX2) or 8 (AVX-512) words per
+//   instruction. The x86 kernels are
+//   compiled for their instruction set individually, and only called if the CPU supports it.
+
+template<class SimOp>
+static void runScalar(const SimOp* ops, GateSize n_ops, uint64_t* vals, int n_words, int w0, int w1)
+{
+    for (GateSize i = 0; i < n_ops; i++){
+        const SimOp&    op = ops[i];
+        uint64_t*       vg = vals + (GateSize)op.g        * n_words;
+        const uint64_t* vx = vals + (GateSize)(op.x >> 1) * n_words;
+        const uint64_t* vy = vals + (GateSize)(op.y >> 1) * n_words;
+        uint64_t        mx = -(uint64_t)(op.x & 1);
+        uint64_t        my = -(uint64_t)(op.y & 1);
+        for (int w = w0; w < w1; w++)
+            vg[w] = (vx[w] ^ mx) & (vy[w] ^ my);
+    }
+}
+
+
+#ifdef MCL_SIM_X86
+template<class SimOp>
+__attribute__((target("avx2")))
+static void runAvx2(const SimOp* ops, GateSize n_ops, uint64_t* vals, int n_words, int w0, int w1)
+{
+    for (GateSize i = 0; i < n_ops; i++){
+        const SimOp&    op = ops[i];
+        uint64_t*       vg = vals + (GateSize)op.g        * n_words;
+        const uint64_t* vx = vals + (GateSize)(op.x >> 1) * n_words;
+        const uint64_t* vy = vals + (GateSize)(op.y >> 1) * n_words;
+        __m256i         mx = _mm256_set1_epi64x(-(long long)(op.x & 1));
+        __m256i         my = _mm256_set1_epi64x(-(long long)(op.y & 1));
+        for (int w = w0; w < w1; w += 4){
+            __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(vx + w)), mx);
+            __m256i y = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(vy + w)), my);
+            _mm256_storeu_si256((__m256i*)(vg + w), _mm256_and_si256(x, y));
+        }
+    }
+}
+
+
+template<class SimOp>
+__attribute__((target("avx512f")))
+static void runAvx512(const SimOp* ops, GateSize n_ops, uint64_t* vals, int n_words, int w0, int w1)
+{
+    for (GateSize i = 0; i < n_ops; i++){
+        const SimOp&    op = ops[i];
+        uint64_t*       vg = vals + (GateSize)op.g        * n_words;
+        const uint64_t* vx = vals + (GateSize)(op.x >> 1) * n_words;
+        const uint64_t* vy = vals + (GateSize)(op.y >> 1) * n_words;
+        __m512i         mx = _mm512_set1_epi64(-(long long)(op.x & 1));
+        __m512i         my = _mm512_set1_epi64(-(long long)(op.y & 1));
+        for (int w = w0; w < w1; w += 8){
+            __m512i x = _mm512_xor_si512(_mm512_loadu_si512((const void*)(vx + w)), mx);
+            __m512i y = _mm512_xor_si512(_mm512_loadu_si512((const void*)(vy + w)), my);
+            _mm512_storeu_si512((void*)(vg + w), _mm512_and_si512(x, y));
+        }
+    }
+}
+#endif
+
+//=================================================================================================
+// CircSim members:
+//
+
+CircSim::CircSim(const Circ& c, int nw, uint64_t seed) : circ(c), n_words(nw), rnd_state(seed ? seed : 1), kern(kernel_Scalar), n_sched(0),
+    n_threads(1), workers(NULL), quit(false), word_split(false)
+{
+    assert(n_words > 0);
+    if      (supported(kernel_Avx512, n_words)) kern = kernel_Avx512;
+    else if (supported(kernel_Avx2,   n_words)) kern = kernel_Avx2;
+    grow();
+    pthread_mutex_init(&start, NULL);
+}
+
+
+CircSim::~CircSim()
+{
+    setThreads(1);
+    pthread_mutex_destroy(&start);
+}
+
+
+bool CircSim::supported(Kernel k, int n_words)
+{
+    switch (k){
+    case kernel_Scalar: return true;
+#ifdef MCL_SIM_X86
+    case kernel_Avx2:   __builtin_cpu_init(); return n_words % 4 == 0 && __builtin_cpu_supports("avx2");
+    case kernel_Avx512: __builtin_cpu_init(); return n_words % 8 == 0 && __builtin_cpu_supports("avx512f");
+#endif
+    default:            return false;
+    }
+}
+
+
+bool CircSim::setKernel(Kernel k)
+{
+    if (!supported(k, n_words))
+        return false;
+    kern = k;
+    buildSteps();
+    return true;
+}
+
+
+const char* CircSim::kernelName(Kernel k)
+{
+    switch (k){
+    case kernel_Scalar: return "scalar";
+    case kernel_Avx2:   return "avx2";
+    case kernel_Avx512: return "avx512";
+    default:            return "?";
+    }
+}
+
+
+// Make room for all gates of the circuit. The constant gate is always true in all patterns:
+void CircSim::grow()
+{
+    GateSize n = ((GateSize)index(circ.lastGate()) + 1) * n_words;
+    if (vals.size() >= n) return;
+
+    GateSize old = vals.size();
+    vals.growTo(n, 0);
+    if (old == 0)
+        for (int w = 0; w < n_words; w++)
+            vals[w] = ~(uint64_t)0;
+}
+
+
+uint64_t CircSim::rndWord()
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 7;
+    rnd_state ^= rnd_state << 17;
+    return rnd_state;
+}
+
+
+void CircSim::randomizeInputs()
+{
+    grow();
+    for (InpIt iit = circ.inpBegin(); iit != circ.inpEnd(); ++iit){
+        uint64_t* v = &vals[(GateSize)index(*iit) * n_words];
+        for (int w = 0; w < n_words; w++)
+            v[w] = rndWord();
+    }
+}
+
+
+// Order all and-gates by level (keeping the order of index within each level), such that gates of
+// the same level are independent of each other:
+void CircSim::buildSchedule()
+{
+    GMap<uint32_t> level(circ.lastGate(), 0);
+    vec<GateSize>  count;
+    for (GateIt git = circ.begin(); git != circ.end(); ++git){
+        Gate g = *git;
+        if (type(g) != gtype_And)
+            continue;
+
+        uint32_t lx = level[gate(circ.lchild(g))];
+        uint32_t ly = level[gate(circ.rchild(g))];
+        level[g] = (lx > ly ? lx : ly) + 1;
+        count.growTo(level[g], 0);
+        count[level[g]-1]++;
+    }
+
+    level_lim.clear();
+    GateSize sum = 0;
+    for (int i = 0; i < count.size(); i++){
+        GateSize n = count[i];
+        count[i]   = sum;
+        sum       += n;
+        level_lim.push(sum);
+    }
+
+    ops.clear();
+    ops.growTo(sum);
+    for (GateIt git = circ.begin(); git != circ.end(); ++git){
+        Gate g = *git;
+        if (type(g) != gtype_And)
+            continue;
+
+        Sig    x  = circ.lchild(g);
+        Sig    y  = circ.rchild(g);
+        SimOp& op = ops[count[level[g]-1]++];
+        op.g = index(g);
+        op.x = index(gate(x)) * 2 + sign(x);
+        op.y = index(gate(y)) * 2 + sign(y);
+    }
+    n_sched = (GateSize)index(circ.lastGate()) + 1;
+}
+
+
+void CircSim::invalidate()
+{
+    ops.clear();
+    level_lim.clear();
+    steps.clear();
+    n_sched = 0;
+}
+
+
+// Group the levels into steps: levels with enough work are split over all threads, and runs of
+// small levels are handled by one thread (saving the synchronization in between):
+void CircSim::buildSteps()
+{
+    steps.clear();
+    word_split = n_threads > 1 && n_words >= n_threads * width(kern);
+    if (n_threads == 1 || word_split)
+        return;
+
+    GateSize begin = 0;
+    for (int i = 0; i < level_lim.size(); i++){
+        GateSize end      = level_lim[i];
+        bool     parallel = (end - begin) * n_words >= (GateSize)sim_min_work * n_threads;
+        if (!parallel && steps.size() > 0 && !steps.last().parallel)
+            steps.last().end = end;
+        else{
+            SimStep st = { begin, end, parallel };
+            steps.push(st);
+        }
+        begin = end;
+    }
+}
+
+
+int CircSim::width(Kernel k)
+{
+    return k == kernel_Avx512 ? 8 : k == kernel_Avx2 ? 4 : 1;
+}
+
+
+void CircSim::run(GateSize begin, GateSize end, int w0, int w1)
+{
+    if (begin == end || w0 == w1)
+        return;
+
+    switch (kern){
+#ifdef MCL_SIM_X86
+    case kernel_Avx512: runAvx512(&ops[begin], end - begin, &vals[0], n_words, w0, w1); break;
+    case kernel_Avx2:   runAvx2  (&ops[begin], end - begin, &vals[0], n_words, w0, w1); break;
+#endif
+    default:            runScalar(&ops[begin], end - begin, &vals[0], n_words, w0, w1); break;
+    }
+}
+
+
+// The part of a simulation that is done by thread 'id' (where the calling thread is 0):
+void CircSim::runThread(int id)
+{
+    if (word_split){
+        // Each thread simulates the whole circuit for a slice of the patterns:
+        int units = n_words / width(kern);
+        int w0    = units *  id      / n_threads * width(kern);
+        int w1    = units * (id + 1) / n_threads * width(kern);
+        run(0, ops.size(), w0, w1);
+        return;
+    }
+
+    for (int i = 0; i < steps.size(); i++){
+        const SimStep& st = steps[i];
+        if (st.parallel){
+            GateSize n = st.end - st.begin;
+            run(st.begin + n * id / n_threads, st.begin + n * (id + 1) / n_threads, 0, n_words);
+        }else if (id == 0)
+            run(st.begin, st.end, 0, n_words);
+
+        if (i + 1 < steps.size())
+            pthread_barrier_wait(&barrier);
+    }
+}
+
+
+void* CircSim::workerMain(void* arg)
+{
+    SimWorker& w = *(SimWorker*)arg;
+
+    // Wait until all threads are created (or the creation failed):
+    pthread_mutex_lock(&w.sim->start);
+    pthread_mutex_unlock(&w.sim->start);
+    if (w.sim->quit)
+        return NULL;
+
+    for (;;){
+        pthread_barrier_wait(&w.sim->barrier);
+        if (w.sim->quit)
+            break;
+        w.sim->runThread(w.id);
+        pthread_barrier_wait(&w.sim->barrier);
+    }
+    return NULL;
+}
+
+
+// Stop the threads of workers '1..n_started'. If 'running' is false the threads are still waiting
+// for 'start' (and the barrier does not exist yet):
+void CircSim::stopThreads(int n_started, bool running)
+{
+    quit = true;
+    if (running)
+        pthread_barrier_wait(&barrier);
+    else
+        pthread_mutex_unlock(&start);
+    for (int i = 1; i <= n_started; i++)
+        pthread_join(workers[i].thread, NULL);
+    if (running)
+        pthread_barrier_destroy(&barrier);
+    delete [] workers;
+    workers   = NULL;
+    n_threads = 1;
+}
+
+
+bool CircSim::setThreads(int n)
+{
+    assert(n >= 1);
+    if (workers != NULL)
+        stopThreads(n_threads - 1, true);
+
+    bool ok = true;
+    n_threads = n;
+    if (n_threads > 1){
+        quit    = false;
+        workers = new SimWorker[n_threads];
+        pthread_mutex_lock(&start);
+        for (int i = 1; i < n_threads; i++){
+            workers[i].sim = this;
+            workers[i].id  = i;
+            if (pthread_create(&workers[i].thread, NULL, workerMain, &workers[i]) != 0){
+                // Fall back to simulating in the calling thread only:
+                stopThreads(i - 1, false);
+                ok = false;
+                break; }
+        }
+        if (ok){
+            pthread_barrier_init(&barrier, NULL, n_threads);
+            pthread_mutex_unlock(&start); }
+    }
+    buildSteps();
+    return ok;
+}
+
+
+void CircSim::simulate()
+{
+    grow();
+    if (n_sched != (GateSize)index(circ.lastGate()) + 1){
+        buildSchedule();
+        buildSteps();
+    }
+
+    if (n_threads == 1)
+        run(0, ops.size(), 0, n_words);
+    else{
+        pthread_barrier_wait(&barrier);
+        runThread(0);
+        pthread_barrier_wait(&barrier);
+    }
+}
+
+
+uint64_t CircSim::hash(Sig x) const
+{
+    const uint64_t* v    = words(gate(x));
+    uint64_t        mask = -(uint64_t)sign(x);
+    uint64_t        h    = 0;
+    for (int w = 0; w < n_words; w++){
+        h ^= (v[w] ^ mask) + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+        h *= 0xFF51AFD7ED558CCDULL;
+    }
+    return h ^ (h >> 33);
+}
+
+//=================================================================================================
+// SeqSim members:
+//
+
+SeqSim::SeqSim(const SeqCirc& c, int n_words, uint64_t seed)
+    : sc(c), main_sim(c.main, n_words, seed), init_sim(c.init, n_words, seed * 31 + 7), n_frames(0)
+{
+    reset();
+}
+
+
+void SeqSim::watch(Sig x)
+{
+    assert(n_frames == 0);
+    watched.push(x);
+}
+
+
+// Evaluate the initial values of all flops (with random values for the inputs of 'init'):
+void SeqSim::reset()
+{
+    init_sim.randomizeInputs();
+    init_sim.simulate();
+
+    int n_words = main_sim.nWords();
+    state.clear();
+    for (int i = 0; i < sc.flps.size(); i++){
+        Sig init = sc.flps.init(sc.flps[i]);
+        for (int w = 0; w < n_words; w++)
+            state.push(init_sim.word(init, w));
+    }
+    trace.clear();
+    n_frames = 0;
+}
+
+
+// Simulate one frame with random inputs, and update the flop state:
+void SeqSim::step()
+{
+    int n_words = main_sim.nWords();
+    main_sim.randomizeInputs();
+    for (int i = 0; i < sc.flps.size(); i++)
+        for (int w = 0; w < n_words; w++)
+            main_sim.setInput(sc.flps[i], w, state[i * n_words + w]);
+    main_sim.simulate();
+
+    for (int i = 0; i < watched.size(); i++)
+        trace.push(main_sim.hash(watched[i]));
+
+    for (int i = 0; i < sc.flps.size(); i++){
+        Sig next = sc.flps.next(sc.flps[i]);
+        for (int w = 0; w < n_words; w++)
+            state[i * n_words + w] = main_sim.word(next, w);
+    }
+    n_frames++;
+}
+
+
+void SeqSim::run(int n)
+{
+    reset();
+    for (int i = 0; i < n; i++)
+        step();
+}
+
+//=================================================================================================
+// TernSim members:
+//
+
+TernSim::TernSim(const SeqCirc& c) : sc(c), n_frames(0), cycle_start(-1), cycle_len(0)
+{
+    inp_hi.growTo(sc.main.lastGate(), ~(uint64_t)0);
+    inp_lo.growTo(sc.main.lastGate(), ~(uint64_t)0);
+    reset();
+}
+
+
+void TernSim::setInput(Gate inp, int lane, lbool val)
+{
+    assert(type(inp) == gtype_Inp);
+    assert(!sc.flps.isFlop(inp));
+    uint64_t bit = (uint64_t)1 << lane;
+    inp_hi[inp] = val == l_False ? inp_hi[inp] & ~bit : inp_hi[inp] | bit;
+    inp_lo[inp] = val == l_True  ? inp_lo[inp] & ~bit : inp_lo[inp] | bit;
+}
+
+
+// Evaluate all and-gates of 'c' (inputs must be set already):
+void TernSim::sweep(const Circ& c, GMap<uint64_t>& hi, GMap<uint64_t>& lo)
+{
+    hi[gate_True] = ~(uint64_t)0;
+    lo[gate_True] = 0;
+    for (GateIt git = c.begin(); git != c.end(); ++git){
+        Gate g = *git;
+        if (type(g) != gtype_And)
+            continue;
+
+        Sig      x  = c.lchild(g);
+        Sig      y  = c.rchild(g);
+        uint64_t hx = sign(x) ? lo[gate(x)] : hi[gate(x)];
+        uint64_t lx = sign(x) ? hi[gate(x)] : lo[gate(x)];
+        uint64_t hy = sign(y) ? lo[gate(y)] : hi[gate(y)];
+        uint64_t ly = sign(y) ? hi[gate(y)] : lo[gate(y)];
+        hi[g] = hx & hy;
+        lo[g] = lx | ly;
+    }
+}
+
+
+// Record the flop values of the current frame, and check if the same state was seen before:
+void TernSim::pushState()
+{
+    int      base = states.size();
+    uint64_t h    = 0;
+    for (int i = 0; i < sc.flps.size(); i++){
+        Gate f = sc.flps[i];
+        states.push(hi[f]);
+        states.push(lo[f]);
+        h = (h ^ hi[f]) * 0xFF51AFD7ED558CCDULL;
+        h = (h ^ lo[f]) * 0xC4CEB9FE1A85EC53ULL;
+
+        if (n_frames > 0 && (hi[f] != states[base - 2 * sc.flps.size() + 2 * i] ||
+                             lo[f] != states[base - 2 * sc.flps.size() + 2 * i + 1]))
+            last_change[i] = n_frames;
+    }
+
+    state_hash.push(h);
+    if (cycle_start >= 0)
+        return;
+
+    // Keep the table of earlier frames at most half full:
+    if (2 * (n_frames + 1) > state_table.size()){
+        int cap = state_table.size() == 0 ? 64 : 2 * state_table.size();
+        state_table.clear();
+        state_table.growTo(cap, -1);
+        for (int f = 0; f < n_frames; f++){
+            uint32_t i = (uint32_t)(state_hash[f] >> 32) & (cap - 1);
+            while (state_table[i] != -1)
+                i = (i + 1) & (cap - 1);
+            state_table[i] = f;
+        }
+    }
+
+    // Look for an earlier frame with the same state, or else add this one:
+    int      n    = 2 * sc.flps.size();
+    uint32_t mask = state_table.size() - 1;
+    uint32_t i;
+    for (i = (uint32_t)(h >> 32) & mask; state_table[i] != -1; i = (i + 1) & mask){
+        int f = state_table[i];
+        if (state_hash[f] == h && memcmp(&states[f * n], &states[base], n * sizeof(uint64_t)) == 0){
+            cycle_start = f;
+            cycle_len   = n_frames - f;
+            return;
+        }
+    }
+    state_table[i] = n_frames;
+}
+
+
+void TernSim::reset()
+{
+    init_hi.clear();
+    init_lo.clear();
+    init_hi.growTo(sc.init.lastGate(), ~(uint64_t)0);
+    init_lo.growTo(sc.init.lastGate(), ~(uint64_t)0);
+    sweep(sc.init, init_hi, init_lo);
+
+    hi.clear();
+    lo.clear();
+    hi.growTo(sc.main.lastGate(), ~(uint64_t)0);
+    lo.growTo(sc.main.lastGate(), ~(uint64_t)0);
+    for (int i = 0; i < sc.flps.size(); i++){
+        Gate f    = sc.flps[i];
+        Sig  init = sc.flps.init(f);
+        hi[f] = sign(init) ? init_lo[gate(init)] : init_hi[gate(init)];
+        lo[f] = sign(init) ? init_hi[gate(init)] : init_lo[gate(init)];
+    }
+
+    states     .clear();
+    state_hash .clear();
+    state_table.clear();
+    next_state .clear();
+    last_change.clear();
+    last_change.growTo(sc.flps.size(), -1);
+    n_frames    = 0;
+    cycle_start = -1;
+    cycle_len   = 0;
+}
+
+
+void TernSim::step()
+{
+    // Latch the state computed by the previous step:
+    for (int i = 0; i < next_state.size() / 2; i++){
+        hi[sc.flps[i]] = next_state[2 * i];
+        lo[sc.flps[i]] = next_state[2 * i + 1];
+    }
+
+    for (InpIt iit = sc.main.inpBegin(); iit != sc.main.inpEnd(); ++iit)
+        if (!sc.flps.isFlop(*iit)){
+            hi[*iit] = inp_hi[*iit];
+            lo[*iit] = inp_lo[*iit];
+        }
+    sweep(sc.main, hi, lo);
+    pushState();
+
+    // Compute the next state, which is latched by the next call (so 'value()' keeps seeing this
+    // frame):
+    next_state.clear();
+    for (int i = 0; i < sc.flps.size(); i++){
+        Sig next = sc.flps.next(sc.flps[i]);
+        next_state.push(sign(next) ? lo[gate(next)] : hi[gate(next)]);
+        next_state.push(sign(next) ? hi[gate(next)] : lo[gate(next)]);
+    }
+    n_frames++;
+}
+
+
+bool TernSim::run(int max_frames)
+{
+    reset();
+    while (!cycleFound() && n_frames < max_frames)
+        step();
+    return cycleFound();
+}
+
+
+lbool TernSim::constValue(int i) const
+{
+    assert(cycleFound());
+    if (last_change[i] > cycle_start)
+        return l_Undef;
+
+    uint64_t h = states[2 * (cycle_start * sc.flps.size() + i)];
+    uint64_t l = states[2 * (cycle_start * sc.flps.size() + i) + 1];
+    return h == ~(uint64_t)0 && l == 0 ? l_True
+         : h == 0 && l == ~(uint64_t)0 ? l_False
+         : l_Undef;
+}
+
+
+int TernSim::constFrom(int i) const
+{
+    assert(cycleFound());
+    return last_change[i] < 0 ? 0 : last_change[i];
+}
+
+
+lbool TernSim::value(Sig x, int lane) const
+{
+    bool h = ((sign(x) ? lo[gate(x)] : hi[gate(x)]) >> lane) & 1;
+    bool l = ((sign(x) ? hi[gate(x)] : lo[gate(x)]) >> lane) & 1;
+    return h && !l ? l_True : !h && l ? l_False : l_Undef;
+}
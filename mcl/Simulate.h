@@ -0,0 +1,223 @@
+/**************************************************************************************[Simulate.h]
+Part of the Mini Circuit Library. See the file LICENSE for copyright and permission notice.
+**************************************************************************************************/
+
+#ifndef Minisat_Simulate_h
+#define Minisat_Simulate_h
+
+#include <pthread.h>
+
+#include "mcl/Circ.h"
+#include "mcl/SeqCirc.h"
+
+namespace Minisat {
+
+// Minimum amount of work (gates times words) per thread for a level to be split over all threads:
+static const int sim_min_work = 4096;
+
+//=================================================================================================
+// CircSim -- bit-parallel simulation of a circuit, 64 patterns per machine word:
+
+class CircSim
+{
+ public:
+    // Simulation kernels (the widest one supported by the CPU is chosen at runtime):
+    enum Kernel { kernel_Scalar, kernel_Avx2, kernel_Avx512 };
+
+ private:
+    // One and-gate of the schedule. Children are stored as 'index * 2 + sign':
+    struct SimOp { GateWord g, x, y; };
+
+    // A range of the schedule that is either split over all threads, or run by one thread:
+    struct SimStep { GateSize begin, end; bool parallel; };
+
+    struct SimWorker { CircSim* sim; int id; pthread_t thread; };
+
+    const Circ&              circ;
+    int                      n_words;   // Number of words (64 patterns each) per gate.
+    vec<uint64_t, GateSize>  vals;      // The words of gate 'g' start at 'vals[index(g) * n_words]'.
+    uint64_t                 rnd_state; // State of the (xorshift) random pattern generator.
+    Kernel                   kern;
+
+    vec<SimOp, GateSize>     ops;       // All and-gates, ordered by level.
+    vec<GateSize>            level_lim; // End of each level in 'ops' (lowest level first).
+    GateSize                 n_sched;   // Number of gates covered by the schedule.
+
+    // Multi-threaded simulation (see 'setThreads()'):
+    int                      n_threads;
+    SimWorker*               workers;   // Index 0 is unused (the calling thread takes part).
+    pthread_barrier_t        barrier;
+    pthread_mutex_t          start;     // Held while the threads are created.
+    volatile bool            quit;
+    bool                     word_split; // Split the words of each gate instead of the levels.
+    vec<SimStep>             steps;
+
+    void            grow         ();
+    void            buildSchedule();
+    void            buildSteps   ();
+    uint64_t        rndWord      ();
+    static int      width        (Kernel k);
+    void            run          (GateSize begin, GateSize end, int w0, int w1);
+    void            runThread    (int id);
+    static void*    workerMain   (void* arg);
+    void            stopThreads  (int n_started, bool running);
+
+ public:
+    CircSim(const Circ& c, int n_words = 1, uint64_t seed = 91648253);
+    ~CircSim();
+
+    int             nWords   () const { return n_words; }
+    int             nPatterns() const { return n_words * 64; }
+
+    // Kernel selection. Wide kernels need 'nWords()' to be a multiple of their width (4 or 8):
+    static bool     supported (Kernel k, int n_words);
+    bool            setKernel (Kernel k);   // Returns false if 'k' can not be used.
+    Kernel          kernel    () const { return kern; }
+    static const char* kernelName(Kernel k);
+
+    // Simulate with 'n' threads (default 1). If every thread gets at least one kernel width of
+    // words, each thread simulates all gates for its own slice of the patterns. Otherwise the gates
+    // of each level are split over the threads, with a barrier between levels. Returns false (and
+    // simulates with one thread) if the threads could not be created:
+    bool            setThreads(int n);
+    int             nThreads  () const { return n_threads; }
+
+    // Set input patterns (inputs that are never set are all zero):
+    void            randomizeInputs();
+    void            setInput  (Gate inp, int w, uint64_t pats);
+    void            setPattern(Gate inp, int k, bool val);
+
+    // Evaluate all and-gates, level by level (growing to include any gates created since the last
+    // call). After gates have been removed or renumbered ('pop()', 'compact()', 'reorder()'),
+    // 'invalidate()' must be called first:
+    void            simulate  ();
+    void            invalidate();
+    int             nLevels   () const { return level_lim.size(); }
+
+    // Inspect simulated values:
+    const uint64_t* words    (Gate g)        const;
+    uint64_t        word     (Sig x, int w)  const;
+    bool            value    (Sig x, int k)  const;
+    bool            phase    (Gate g)        const; // The value of 'g' in pattern 0.
+    uint64_t        hash     (Sig x)         const; // Hash of all patterns of 'x'.
+    uint64_t        signature(Gate g)        const; // Same for 'g' in its 'phase()' (equal for 'g' and '~g').
+};
+
+
+//=================================================================================================
+// SeqSim -- bit-parallel cycle-based simulation of a sequential circuit:
+//
+//   Each of the 'nPatterns()' patterns is an independent run from an initial state, given by the
+//   flop initializers evaluated on 'SeqCirc::init' (whose inputs are random, i.e. X-initialized
+//   flops get random values), and with random values for the primary inputs in every cycle.
+
+class SeqSim
+{
+    const SeqCirc&   sc;
+    CircSim          main_sim;
+    CircSim          init_sim;
+    vec<uint64_t>    state;     // Words of flop 'sc.flps[i]' start at 'state[i * nWords()]'.
+    vec<Sig>         watched;
+    vec<uint64_t>    trace;     // Hash of watched signal 'i' in frame 'f' is 'trace[f * watched.size() + i]'.
+    int              n_frames;
+
+ public:
+    SeqSim(const SeqCirc& sc, int n_words = 1, uint64_t seed = 91648253);
+
+    // Record the hash (see 'CircSim::hash()') of 'x' in every frame. Must be called before 'step()':
+    void             watch    (Sig x);
+
+    void             reset    ();       // Go to the initial state (frame 0).
+    void             step     ();       // Simulate the current frame and go to the next.
+    void             run      (int n);  // Reset, then simulate 'n' frames.
+
+    int              nFrames  ()               const { return n_frames; }
+    uint64_t         frameHash(int f, int i)   const { return trace[f * watched.size() + i]; }
+
+    // Values of the last simulated frame (flop inputs hold the state of that frame):
+    const CircSim&   values   ()               const { return main_sim; }
+};
+
+
+//=================================================================================================
+// TernSim -- bit-parallel three-valued (0/1/X) simulation of a sequential circuit:
+//
+//   Every signal is stored as two bit-planes of 64 lanes each: 'hi' (the value may be 1) and 'lo'
+//   (the value may be 0), so X is both. Negation swaps the planes, and an and-gate is 'hi = hx & hy',
+//   'lo = lx | ly'. Primary inputs are X in all lanes unless set with 'setInput()', and so are the
+//   inputs of 'SeqCirc::init' (X-initialized flops). Lanes are independent runs, and the analysis
+//   results hold for all lanes.
+
+class TernSim
+{
+    const SeqCirc&   sc;
+    GMap<uint64_t>   hi, lo;        // Planes of 'main'.
+    GMap<uint64_t>   init_hi;       // }- Planes of 'init'.
+    GMap<uint64_t>   init_lo;       // }
+    GMap<uint64_t>   inp_hi;        // }- Fixed values of primary inputs.
+    GMap<uint64_t>   inp_lo;        // }
+
+    vec<uint64_t>    states;        // Flop planes of every frame ('2 * flps.size()' words per frame).
+    vec<uint64_t>    state_hash;
+    vec<int>         state_table;   // Open-addressing table of frames by 'state_hash' (-1 if free).
+    vec<uint64_t>    next_state;    // Flop planes latched at the start of the next 'step()'.
+    vec<int>         last_change;   // Last frame in which each flop changed value (-1 if never).
+    int              n_frames;
+    int              cycle_start;   // First frame of the cycle ('-1' if not found yet).
+    int              cycle_len;
+
+    static void      sweep      (const Circ& c, GMap<uint64_t>& hi, GMap<uint64_t>& lo);
+    void             pushState  ();
+
+ public:
+    TernSim(const SeqCirc& sc);
+
+    void             setInput   (Gate inp, int lane, lbool val); // Fix a primary input in 'lane'.
+
+    void             reset      ();       // Go to the initial state (frame 0).
+    void             step       ();       // Simulate the current frame and go to the next.
+    bool             run        (int max_frames); // Reset, then step until the states repeat.
+
+    int              nFrames    () const { return n_frames; }
+    bool             cycleFound () const { return cycle_start >= 0; }
+    int              transient  () const { return cycle_start; } // Frames before the cycle.
+    int              period     () const { return cycle_len; }
+
+    // After a cycle was found: the constant value of flop 'sc.flps[i]' from frame 'constFrom(i)' and
+    // on, or 'l_Undef' if it is not constant (or X) in all lanes:
+    lbool            constValue (int i) const;
+    int              constFrom  (int i) const;
+
+    // Value in the last simulated frame (flops hold their value in that frame, not the next state
+    // already computed for the coming one). Before the first 'step()' only the flops are defined:
+    lbool            value      (Sig x, int lane) const;
+};
+
+
+//=================================================================================================
+// Implementation of inline methods:
+
+inline const uint64_t* CircSim::words(Gate g) const { return &vals[(GateSize)index(g) * n_words]; }
+inline uint64_t CircSim::word (Sig x, int w) const { return words(gate(x))[w] ^ -(uint64_t)sign(x); }
+inline bool     CircSim::value(Sig x, int k) const { return ((words(gate(x))[k >> 6] >> (k & 63)) & 1) ^ sign(x); }
+inline bool     CircSim::phase(Gate g)       const { return words(g)[0] & 1; }
+inline uint64_t CircSim::signature(Gate g)   const { return hash(mkSig(g, phase(g))); }
+
+inline void CircSim::setInput(Gate inp, int w, uint64_t pats)
+{
+    assert(type(inp) == gtype_Inp);
+    grow();
+    vals[(GateSize)index(inp) * n_words + w] = pats;
+}
+
+inline void CircSim::setPattern(Gate inp, int k, bool val)
+{
+    assert(type(inp) == gtype_Inp);
+    grow();
+    uint64_t& v = vals[(GateSize)index(inp) * n_words + (k >> 6)];
+    v = (v & ~((uint64_t)1 << (k & 63))) | ((uint64_t)val << (k & 63));
+}
+
+};
+
+#endif
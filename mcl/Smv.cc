@@ -29,7 +29,7 @@ static void writeSmvSig(FILE* f, Sig x)
     else if (x == sig_False)
         fprintf(f, "0");
     else
-        fprintf(f, "%s%c%03d", sign(x)?"!":"", type(x) == gtype_Inp ? 'x' : 'g', index(gate(x)));
+        fprintf(f, "%s%c%03"PRIgw, sign(x)?"!":"", type(x) == gtype_Inp ? 'x' : 'g', index(gate(x)));
 }
 
 static void writeSmvWithOp(FILE* f, const char* op, vec<Sig>& xs)